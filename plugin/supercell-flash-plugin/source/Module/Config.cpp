@@ -56,6 +56,21 @@ namespace sc {
 			writeCustomProperties = data["writeCustomProperties"];
 			context.logger->info("	writeCustomProperties: {}", writeCustomProperties);
 
+			if (data["tessellateCurves"].is_boolean()) {
+				tessellateCurves = data["tessellateCurves"];
+				context.logger->info("	tessellateCurves: {}", tessellateCurves);
+			}
+
+			if (data["tessellateStrokes"].is_boolean()) {
+				tessellateStrokes = data["tessellateStrokes"];
+				context.logger->info("	tessellateStrokes: {}", tessellateStrokes);
+			}
+
+			if (data["shapeArenas"].is_boolean()) {
+				shapeArenas = data["shapeArenas"];
+				context.logger->info("	shapeArenas: {}", shapeArenas);
+			}
+
 			exportToExternal = data["exportToExternal"];
 			context.logger->info("	exportToExternal: {}", exportToExternal);
 
@@ -65,6 +80,11 @@ namespace sc {
 			repackAtlas = data["repackAtlas"];
 			context.logger->info("	repackAtlas: {}", repackAtlas);
 
+			if (data["appendAtlas"].is_boolean()) {
+				appendAtlas = data["appendAtlas"];
+				context.logger->info("	appendAtlas: {}", appendAtlas);
+			}
+
 			hasExternalTexture = data["hasExternalTexture"];
 			context.logger->info("	hasExternalTexture: {}", hasExternalTexture);
 			hasExternalTextureFile = data["hasExternalTextureFile"];
@@ -117,6 +137,21 @@ namespace sc {
 				context.logger->info("	textureQuality: {}", (uint8_t)textureQuality);
 			}
 
+			if (data["packagingEffort"].is_number_unsigned()) {
+				packagingEffort = (PackagingEffort)data["packagingEffort"];
+				context.logger->info("	packagingEffort: {}", (uint8_t)packagingEffort);
+			}
+
+			if (data["spriteMeshVertices"].is_number_unsigned()) {
+				spriteMeshVertices = data["spriteMeshVertices"];
+				context.logger->info("	spriteMeshVertices: {}", spriteMeshVertices);
+			}
+
+			if (data["adaptiveRasterization"].is_number_unsigned()) {
+				adaptiveRasterization = (AdaptiveRasterization)data["adaptiveRasterization"];
+				context.logger->info("	adaptiveRasterization: {}", (uint8_t)adaptiveRasterization);
+			}
+
 			if (data["multiResolutinSuffix"].is_string()) {
 				multiResolutionSuffix = data["multiResolutinSuffix"];
 				context.logger->info("	multiResolutinSuffix: {}", multiResolutionSuffix);
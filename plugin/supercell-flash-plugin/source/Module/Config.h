@@ -22,6 +22,21 @@ namespace sc {
 				Low
 			};
 
+			// How much time atlas packaging may spend for better texture density
+			enum class PackagingEffort : uint8_t {
+				Draft,
+				Balanced,
+				Best
+			};
+
+			// Max resolution of rasterized shapes picked from their on-screen scale
+			enum class AdaptiveRasterization : uint8_t {
+				Disabled,
+				Low,
+				Medium,
+				High
+			};
+
 			enum class SWFType : uint8_t {
 				SC1,
 				SC2
@@ -46,6 +61,7 @@ namespace sc {
 			bool exportToExternal = false;
 			fs::path exportToExternalPath = "";
 			bool repackAtlas = true;
+			bool appendAtlas = false;
 
 			sc::flash::SWFTexture::TextureEncoding textureEncoding = sc::flash::SWFTexture::TextureEncoding::KhronosTexture;
 			bool hasExternalTexture = false;
@@ -59,9 +75,17 @@ namespace sc {
 			Quality textureQuality = Quality::Highest;
 			uint32_t textureMaxWidth = 4096;
 			uint32_t textureMaxHeight = 4096;
+			PackagingEffort packagingEffort = PackagingEffort::Balanced;
+			uint8_t spriteMeshVertices = 0;
+			AdaptiveRasterization adaptiveRasterization = AdaptiveRasterization::Disabled;
 
 			bool writeCustomProperties = true;
 			bool hasPrecisionMatrices = false;
+			bool tessellateCurves = false;
+			bool tessellateStrokes = false;
+
+			// Not shown in publish settings, turned off only to compare heap use of shapes without arenas
+			bool shapeArenas = true;
 		public:
 			virtual void FromDict(const FCM::PIFCMDictionary dict) override;
 			void Load(const FCM::PIFCMDictionary dict);
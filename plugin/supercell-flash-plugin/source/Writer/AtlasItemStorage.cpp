@@ -0,0 +1,587 @@
+#include "AtlasItemStorage.h"
+
+#include "Writer/GraphicItem/SpriteItem.h"
+#include "Writer/GraphicItem/FilledItem.h"
+
+#include "core/hashing/ncrypto/xxhash.h"
+#include "core/exception/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_ALPHA_SCAN_SSE2
+#endif
+
+namespace sc {
+	namespace Adobe {
+		AtlasItemStorage::Reference AtlasItemStorage::Add(const GraphicItem& item)
+		{
+			if (item.IsSprite())
+			{
+				const BitmapItem& sprite_item = (const BitmapItem&)item;
+
+				// Rasterized sprites already has premultiplied alpha so no need to preprocess it
+				bool preprocessed = sprite_item.IsRasterizedVector() || item.Is9Sliced();
+
+				return AddSprite(sprite_item.Image(), preprocessed, item.Is9Sliced());
+			}
+			else if (item.IsSolidColor())
+			{
+				Reference reference;
+				reference.index = AddColor(item.Color());
+
+				return reference;
+			}
+
+			throw wk::Exception("Not implemented");
+		}
+
+		wk::Matrix2D AtlasItemStorage::GetSourceMatrix(const Reference& reference) const
+		{
+			const Entry& entry = m_entries[reference.index];
+			const Orientation& orientation = reference.orientation;
+
+			const float trim_x = (float)reference.offset_x;
+			const float trim_y = (float)reference.offset_y;
+
+			if (!entry.image || orientation.IsIdentity())
+			{
+				return wk::Matrix2D(1.f, 0.f, 0.f, 1.f, trim_x, trim_y);
+			}
+
+			// Undo flips in canonical space
+			float scale_x = orientation.flip_x ? -1.f : 1.f;
+			float scale_y = orientation.flip_y ? -1.f : 1.f;
+			float offset_x = orientation.flip_x ? (float)entry.image->width() : 0.f;
+			float offset_y = orientation.flip_y ? (float)entry.image->height() : 0.f;
+
+			// And then transpose back
+			if (orientation.transpose)
+			{
+				return wk::Matrix2D(0.f, scale_x, scale_y, 0.f, offset_y + trim_x, offset_x + trim_y);
+			}
+
+			return wk::Matrix2D(scale_x, 0.f, 0.f, scale_y, offset_x + trim_x, offset_y + trim_y);
+		}
+
+		AtlasItemStorage::Reference AtlasItemStorage::AddSprite(const wk::RawImage& image, bool preprocessed, bool sliced)
+		{
+			// Fast path: same image instance, e.g bitmap from library used by many shapes
+			auto key = std::make_tuple(&image, preprocessed, sliced);
+			auto instance_it = m_image_items.find(key);
+			if (instance_it != m_image_items.end())
+			{
+				return instance_it->second;
+			}
+
+			Reference reference;
+
+			// Transparent borders only waste atlas space and fill rate.
+			// 9Slice guides are bound to image space so such images stay as is.
+			wk::RawImageRef trimmed_image;
+			const wk::RawImage* source_image = &image;
+			if (!sliced)
+			{
+				trimmed_image = AtlasItemStorage::TrimImage(image, reference.offset_x, reference.offset_y);
+				if (trimmed_image)
+				{
+					source_image = trimmed_image.get();
+				}
+			}
+
+			// Canonical orientation is the one with the smallest pixel hash,
+			// so all flipped and rotated copies of image end up with the same key.
+			uint64_t hash = AtlasItemStorage::ImageHash(*source_image, reference.orientation);
+
+			if (!sliced)
+			{
+				for (uint8_t variant = 1; 8 > variant; variant++)
+				{
+					Orientation orientation;
+					orientation.transpose = variant & 0b001;
+					orientation.flip_x = variant & 0b010;
+					orientation.flip_y = variant & 0b100;
+
+					uint64_t variant_hash = AtlasItemStorage::ImageHash(*source_image, orientation);
+					if (hash > variant_hash)
+					{
+						hash = variant_hash;
+						reference.orientation = orientation;
+					}
+				}
+			}
+
+			wk::RawImageRef oriented_image = trimmed_image;
+			if (!reference.orientation.IsIdentity())
+			{
+				oriented_image = AtlasItemStorage::OrientImage(*source_image, reference.orientation);
+			}
+
+			const wk::RawImage* canonical_image = oriented_image ? oriented_image.get() : &image;
+
+			// Slow path: different images with identical pixels
+			std::vector<size_t>& candidates = m_hashed_items[hash];
+			for (size_t candidate : candidates)
+			{
+				const Entry& entry = m_entries[candidate];
+				if (entry.preprocessed != preprocessed || entry.sliced != sliced) continue;
+
+				if (AtlasItemStorage::IsSameImage(*entry.image, *canonical_image))
+				{
+					reference.index = candidate;
+					m_image_items[key] = reference;
+					return reference;
+				}
+			}
+
+			if (trimmed_image)
+			{
+				m_trimmed_pixels += (size_t)image.width() * image.height() - (size_t)trimmed_image->width() * trimmed_image->height();
+			}
+
+			if (oriented_image)
+			{
+				m_images.push_back(oriented_image);
+			}
+
+			reference.index = m_items.size();
+
+			auto& atlas_item = m_items.emplace_back(*canonical_image, sliced);
+			if (preprocessed)
+			{
+				atlas_item.mark_as_preprocessed();
+			}
+
+			// Tight mesh cuts both atlas space and overdraw of transparent pixels
+			std::vector<wk::PointF> polygon;
+			if (!sliced && m_mesh_vertex_budget && AtlasItemStorage::TraceMesh(*canonical_image, m_mesh_vertex_budget, polygon))
+			{
+				for (const wk::PointF& point : polygon)
+				{
+					auto& vertex = atlas_item.vertices.emplace_back();
+					vertex.xy.x = point.x;
+					vertex.xy.y = point.y;
+					vertex.uv.u = (uint16_t)point.x;
+					vertex.uv.v = (uint16_t)point.y;
+				}
+
+				if (atlas_item.mark_as_custom())
+				{
+					m_meshed_sprites++;
+				}
+				else
+				{
+					atlas_item.vertices.clear();
+				}
+			}
+
+			Entry& entry = m_entries.emplace_back();
+			entry.image = canonical_image;
+			entry.preprocessed = preprocessed;
+			entry.sliced = sliced;
+
+			candidates.push_back(reference.index);
+			m_image_items[key] = reference;
+
+			return reference;
+		}
+
+		size_t AtlasItemStorage::AddColor(const wk::ColorRGBA& color)
+		{
+			uint32_t key = ((uint32_t)color.r << 24) | ((uint32_t)color.g << 16) | ((uint32_t)color.b << 8) | color.a;
+
+			auto it = m_color_items.find(key);
+			if (it != m_color_items.end())
+			{
+				return it->second;
+			}
+
+			size_t index = m_items.size();
+			m_items.emplace_back(color);
+
+			Entry& entry = m_entries.emplace_back();
+			entry.color = color;
+
+			m_color_items[key] = index;
+
+			return index;
+		}
+
+		// Size of image after orientation and position of source pixel for canonical pixel
+		static void GetOrientedSize(const wk::RawImage& image, const AtlasItemStorage::Orientation& orientation, uint16_t& width, uint16_t& height)
+		{
+			width = orientation.transpose ? image.height() : image.width();
+			height = orientation.transpose ? image.width() : image.height();
+		}
+
+		static const uint8_t* GetSourcePixel(
+			const wk::RawImage& image, const AtlasItemStorage::Orientation& orientation,
+			uint16_t width, uint16_t height,
+			uint16_t x, uint16_t y
+		)
+		{
+			uint16_t source_x = orientation.flip_x ? width - 1 - x : x;
+			uint16_t source_y = orientation.flip_y ? height - 1 - y : y;
+
+			if (orientation.transpose)
+			{
+				std::swap(source_x, source_y);
+			}
+
+			return image.data() + ((size_t)source_y * image.width() + source_x) * image.pixel_size();
+		}
+
+		uint64_t AtlasItemStorage::ImageHash(const wk::RawImage& image, const Orientation& orientation)
+		{
+			wk::hash::XxHash code;
+
+			uint16_t width, height;
+			GetOrientedSize(image, orientation, width, height);
+
+			code.update(width);
+			code.update(height);
+			code.update((uint8_t)image.depth());
+
+			const size_t pixel_size = image.pixel_size();
+
+			if (orientation.IsIdentity())
+			{
+				code.update(image.data(), (size_t)width * height * pixel_size);
+				return code.digest();
+			}
+
+			// Hash image row by row in oriented order without creating the image itself
+			std::vector<uint8_t> row((size_t)width * pixel_size);
+			for (uint16_t y = 0; height > y; y++)
+			{
+				for (uint16_t x = 0; width > x; x++)
+				{
+					const uint8_t* pixel = GetSourcePixel(image, orientation, width, height, x, y);
+					std::memcpy(row.data() + (size_t)x * pixel_size, pixel, pixel_size);
+				}
+
+				code.update(row.data(), row.size());
+			}
+
+			return code.digest();
+		}
+
+		wk::RawImageRef AtlasItemStorage::OrientImage(const wk::RawImage& image, const Orientation& orientation)
+		{
+			uint16_t width, height;
+			GetOrientedSize(image, orientation, width, height);
+
+			wk::RawImageRef result = wk::CreateRef<wk::RawImage>(
+				width, height, image.depth(), image.colorspace()
+			);
+
+			const size_t pixel_size = image.pixel_size();
+			uint8_t* destination = result->data();
+
+			for (uint16_t y = 0; height > y; y++)
+			{
+				for (uint16_t x = 0; width > x; x++)
+				{
+					const uint8_t* pixel = GetSourcePixel(image, orientation, width, height, x, y);
+					std::memcpy(destination + ((size_t)y * width + x) * pixel_size, pixel, pixel_size);
+				}
+			}
+
+			return result;
+		}
+
+		// Scans alpha channel of RGBA8 image for bound of pixels that are not fully transparent
+		// Returns false if whole image is transparent
+		static bool GetOpaqueBound(const wk::RawImage& image, uint16_t& left, uint16_t& top, uint16_t& right, uint16_t& bottom)
+		{
+			const uint16_t width = image.width();
+			const uint16_t height = image.height();
+			const uint32_t* pixels = (const uint32_t*)image.data();
+
+			// RGBA in memory, alpha is the highest byte of little endian word
+			const uint32_t alpha_mask = 0xFF000000;
+
+			bool found = false;
+			left = width;
+			right = 0;
+			top = height;
+			bottom = 0;
+
+			for (uint16_t y = 0; height > y; y++)
+			{
+				const uint32_t* row = pixels + (size_t)y * width;
+				int32_t first = -1;
+				int32_t last = -1;
+
+				uint16_t x = 0;
+
+#ifdef SC_ALPHA_SCAN_SSE2
+				const __m128i mask = _mm_set1_epi32((int)alpha_mask);
+				const __m128i zero = _mm_setzero_si128();
+
+				for (; width >= x + 4; x += 4)
+				{
+					__m128i block = _mm_loadu_si128((const __m128i*)(row + x));
+					__m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(block, mask), zero);
+
+					// One bit per pixel that has any alpha
+					int visible = ~_mm_movemask_ps(_mm_castsi128_ps(transparent)) & 0b1111;
+					if (!visible) continue;
+
+					if (0 > first)
+					{
+						for (int i = 0; 4 > i; i++)
+						{
+							if (visible & (1 << i))
+							{
+								first = x + i;
+								break;
+							}
+						}
+					}
+
+					for (int i = 3; i >= 0; i--)
+					{
+						if (visible & (1 << i))
+						{
+							last = x + i;
+							break;
+						}
+					}
+				}
+#endif
+
+				for (; width > x; x++)
+				{
+					if (!(row[x] & alpha_mask)) continue;
+
+					if (0 > first) first = x;
+					last = x;
+				}
+
+				if (0 > first) continue;
+
+				found = true;
+				left = std::min(left, (uint16_t)first);
+				right = std::max(right, (uint16_t)(last + 1));
+				top = std::min(top, y);
+				bottom = y + 1;
+			}
+
+			return found;
+		}
+
+		wk::RawImageRef AtlasItemStorage::TrimImage(const wk::RawImage& image, uint16_t& offset_x, uint16_t& offset_y)
+		{
+			if (image.depth() != wk::Image::PixelDepth::RGBA8) return nullptr;
+
+			uint16_t left, top, right, bottom;
+			if (!GetOpaqueBound(image, left, top, right, bottom)) return nullptr;
+
+			if (left == 0 && top == 0 && right == image.width() && bottom == image.height()) return nullptr;
+
+			const uint16_t width = right - left;
+			const uint16_t height = bottom - top;
+
+			wk::RawImageRef result = wk::CreateRef<wk::RawImage>(
+				width, height, image.depth(), image.colorspace()
+			);
+
+			const size_t pixel_size = image.pixel_size();
+			for (uint16_t y = 0; height > y; y++)
+			{
+				std::memcpy(
+					result->data() + (size_t)y * width * pixel_size,
+					image.data() + ((size_t)(top + y) * image.width() + left) * pixel_size,
+					(size_t)width * pixel_size
+				);
+			}
+
+			offset_x = left;
+			offset_y = top;
+
+			return result;
+		}
+
+		// Positive for counter clockwise turn at b
+		static float Cross(const wk::PointF& a, const wk::PointF& b, const wk::PointF& c)
+		{
+			return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+		}
+
+		static float PolygonArea(const std::vector<wk::PointF>& polygon)
+		{
+			float area = 0.f;
+			for (size_t i = 0; polygon.size() > i; i++)
+			{
+				const wk::PointF& a = polygon[i];
+				const wk::PointF& b = polygon[(i + 1) % polygon.size()];
+				area += a.x * b.y - b.x * a.y;
+			}
+
+			return std::abs(area) / 2.f;
+		}
+
+		bool AtlasItemStorage::TraceMesh(const wk::RawImage& image, uint8_t vertex_budget, std::vector<wk::PointF>& polygon)
+		{
+			if (image.depth() != wk::Image::PixelDepth::RGBA8 || 3 > vertex_budget) return false;
+
+			const uint16_t width = image.width();
+			const uint16_t height = image.height();
+			const uint32_t* pixels = (const uint32_t*)image.data();
+			const uint32_t alpha_mask = 0xFF000000;
+
+			// Outer pixel corners of every row are enough for convex outline
+			std::vector<wk::PointF> points;
+			for (uint16_t y = 0; height > y; y++)
+			{
+				const uint32_t* row = pixels + (size_t)y * width;
+
+				int32_t first = -1;
+				int32_t last = -1;
+				for (uint16_t x = 0; width > x; x++)
+				{
+					if (!(row[x] & alpha_mask)) continue;
+
+					if (0 > first) first = x;
+					last = x;
+				}
+
+				if (0 > first) continue;
+
+				points.push_back(wk::PointF((float)first, (float)y));
+				points.push_back(wk::PointF((float)first, (float)y + 1));
+				points.push_back(wk::PointF((float)last + 1, (float)y));
+				points.push_back(wk::PointF((float)last + 1, (float)y + 1));
+			}
+
+			if (3 > points.size()) return false;
+
+			// Monotone chain convex hull
+			std::sort(points.begin(), points.end(), [](const wk::PointF& a, const wk::PointF& b) {
+				return a.x < b.x || (a.x == b.x && a.y < b.y);
+			});
+
+			std::vector<wk::PointF> hull(points.size() * 2);
+			size_t count = 0;
+			for (size_t i = 0; points.size() > i; i++)
+			{
+				while (count >= 2 && 0.f >= Cross(hull[count - 2], hull[count - 1], points[i])) count--;
+				hull[count++] = points[i];
+			}
+
+			for (size_t i = points.size() - 1, lower = count + 1; i > 0; i--)
+			{
+				while (count >= lower && 0.f >= Cross(hull[count - 2], hull[count - 1], points[i - 1])) count--;
+				hull[count++] = points[i - 1];
+			}
+
+			hull.resize(count - 1);
+			if (3 > hull.size()) return false;
+
+			const std::vector<wk::PointF> outline = hull;
+
+			// Reduce vertex count by replacing edges with intersection of neighbor edges.
+			// Unlike Douglas-Peucker it never cuts visible pixels and result stays convex.
+			const float epsilon = 0.01f;
+			while (hull.size() > vertex_budget)
+			{
+				size_t best_edge = SIZE_MAX;
+				float best_area = std::numeric_limits<float>::max();
+				wk::PointF best_point;
+
+				for (size_t i = 0; hull.size() > i; i++)
+				{
+					const wk::PointF& previous = hull[(i + hull.size() - 1) % hull.size()];
+					const wk::PointF& a = hull[i];
+					const wk::PointF& b = hull[(i + 1) % hull.size()];
+					const wk::PointF& next = hull[(i + 2) % hull.size()];
+
+					float d1x = a.x - previous.x, d1y = a.y - previous.y;
+					float d2x = next.x - b.x, d2y = next.y - b.y;
+
+					// Neighbor edges must converge outside of polygon
+					float denominator = d1x * d2y - d1y * d2x;
+					if (epsilon >= denominator) continue;
+
+					float t = ((b.x - a.x) * d2y - (b.y - a.y) * d2x) / denominator;
+					if (0.f > t) continue;
+
+					wk::PointF point(a.x + d1x * t, a.y + d1y * t);
+
+					// Vertex outside of image would sample neighbor sprites in atlas
+					if (-epsilon > point.x || -epsilon > point.y || point.x > width + epsilon || point.y > height + epsilon) continue;
+
+					float area = std::abs((b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x)) / 2.f;
+					if (best_area > area)
+					{
+						best_area = area;
+						best_edge = i;
+						best_point = point;
+					}
+				}
+
+				if (best_edge == SIZE_MAX) return false;
+
+				size_t second = (best_edge + 1) % hull.size();
+				hull[best_edge] = wk::PointF(
+					std::clamp(best_point.x, 0.f, (float)width),
+					std::clamp(best_point.y, 0.f, (float)height)
+				);
+				hull.erase(hull.begin() + second);
+			}
+
+			// Texture coordinates are integer so vertices are moved away from center to pixel corners
+			wk::PointF center(0.f, 0.f);
+			for (const wk::PointF& point : hull)
+			{
+				center.x += point.x / hull.size();
+				center.y += point.y / hull.size();
+			}
+
+			for (wk::PointF& point : hull)
+			{
+				point.x = std::clamp(point.x < center.x ? std::floor(point.x) : std::ceil(point.x), 0.f, (float)width);
+				point.y = std::clamp(point.y < center.y ? std::floor(point.y) : std::ceil(point.y), 0.f, (float)height);
+			}
+
+			// Snapping may bend polygon, it still must be convex and cover whole outline
+			for (size_t i = 0; hull.size() > i; i++)
+			{
+				const wk::PointF& a = hull[i];
+				const wk::PointF& b = hull[(i + 1) % hull.size()];
+
+				if (0.f >= Cross(hull[(i + hull.size() - 1) % hull.size()], a, b)) return false;
+
+				for (const wk::PointF& point : outline)
+				{
+					if (-epsilon > (b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x)) return false;
+				}
+			}
+
+			// Not worth it if polygon is almost the same as quad
+			if (PolygonArea(hull) > (float)width * height * 0.9f) return false;
+
+			polygon = std::move(hull);
+			return true;
+		}
+
+		bool AtlasItemStorage::IsSameImage(const wk::RawImage& first, const wk::RawImage& second)
+		{
+			if (&first == &second) return true;
+
+			if (first.width() != second.width() ||
+				first.height() != second.height() ||
+				first.depth() != second.depth())
+			{
+				return false;
+			}
+
+			size_t length = (size_t)first.width() * first.height() * first.pixel_size();
+			return std::memcmp(first.data(), second.data(), length) == 0;
+		}
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "atlas_generator/Item/Item.h"
+#include "core/image/raw_image.h"
+#include "core/math/matrix2d.h"
+#include "core/memory/ref.h"
+
+#include "Writer/GraphicItem/GraphicItem.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace sc {
+	namespace Adobe {
+		// Collects unique atlas items for graphic items of all shapes
+		// Same image or same color used by many shapes becomes only one item for atlas generator
+		// Sprites that are flipped or rotated by 90 degrees copies of each other are stored in one canonical orientation
+		// Fully transparent borders of sprites are trimmed before anything else
+		class AtlasItemStorage
+		{
+		public:
+			// One of 8 square symmetries. Pixels are transposed first and then flipped.
+			struct Orientation
+			{
+				bool transpose = false;
+				bool flip_x = false;
+				bool flip_y = false;
+
+				bool IsIdentity() const
+				{
+					return !transpose && !flip_x && !flip_y;
+				}
+			};
+
+			struct Entry
+			{
+				// Image of sprite item in canonical orientation or nullptr for colorfill
+				const wk::RawImage* image = nullptr;
+				wk::ColorRGBA color;
+
+				bool preprocessed = false;
+				bool sliced = false;
+			};
+
+			struct Reference
+			{
+				size_t index = 0;
+
+				// Orientation that turns graphic item image into canonical one
+				Orientation orientation;
+
+				// Position of trimmed content in graphic item image
+				uint16_t offset_x = 0;
+				uint16_t offset_y = 0;
+			};
+
+		public:
+			/// <param name="mesh_vertex_budget">Max vertex count of tight sprite mesh or 0 to keep bounding quads</param>
+			AtlasItemStorage(uint8_t mesh_vertex_budget = 0) : m_mesh_vertex_budget(mesh_vertex_budget)
+			{
+			}
+
+		public:
+			/// <summary>
+			/// Finds or creates atlas item for graphic item
+			/// </summary>
+			/// <param name="item">Graphic item</param>
+			/// <returns>Atlas item index and orientation of graphic item relative to it</returns>
+			Reference Add(const GraphicItem& item);
+
+			/// <summary>
+			/// Matrix that maps local coordinates of atlas item back to graphic item image space.
+			/// Includes orientation and offset of trimmed borders.
+			/// </summary>
+			wk::Matrix2D GetSourceMatrix(const Reference& reference) const;
+
+			std::vector<wk::AtlasGenerator::Item>& Items()
+			{
+				return m_items;
+			}
+
+			const Entry& GetEntry(size_t index) const
+			{
+				return m_entries[index];
+			}
+
+			size_t Size() const
+			{
+				return m_items.size();
+			}
+
+			// Count of transparent pixels that were cut off from sprites
+			size_t TrimmedPixels() const
+			{
+				return m_trimmed_pixels;
+			}
+
+			// Count of sprites that got tight mesh instead of bounding quad
+			size_t MeshedSprites() const
+			{
+				return m_meshed_sprites;
+			}
+
+		private:
+			Reference AddSprite(const wk::RawImage& image, bool preprocessed, bool sliced);
+			size_t AddColor(const wk::ColorRGBA& color);
+
+			static uint64_t ImageHash(const wk::RawImage& image, const Orientation& orientation);
+			static wk::RawImageRef OrientImage(const wk::RawImage& image, const Orientation& orientation);
+			static wk::RawImageRef TrimImage(const wk::RawImage& image, uint16_t& offset_x, uint16_t& offset_y);
+			static bool IsSameImage(const wk::RawImage& first, const wk::RawImage& second);
+
+			/// <summary>
+			/// Builds convex polygon around all visible pixels of RGBA8 image with no more than given vertex count
+			/// </summary>
+			/// <returns>False if polygon can't be built or it is not smaller than image rectangle</returns>
+			static bool TraceMesh(const wk::RawImage& image, uint8_t vertex_budget, std::vector<wk::PointF>& polygon);
+
+		private:
+			std::vector<wk::AtlasGenerator::Item> m_items;
+			std::vector<Entry> m_entries;
+
+			// Storage for reoriented images
+			std::vector<wk::RawImageRef> m_images;
+
+			// Image instance / preprocessed / sliced
+			std::map<std::tuple<const wk::RawImage*, bool, bool>, Reference> m_image_items;
+
+			// Pixel hash / candidates
+			std::unordered_map<uint64_t, std::vector<size_t>> m_hashed_items;
+
+			// RGBA / item
+			std::unordered_map<uint32_t, size_t> m_color_items;
+
+			uint8_t m_mesh_vertex_budget;
+
+			size_t m_trimmed_pixels = 0;
+			size_t m_meshed_sprites = 0;
+		};
+	}
+}
@@ -0,0 +1,23 @@
+#include "CountingResource.h"
+
+namespace sc {
+	namespace Adobe {
+		void* CountingResource::do_allocate(size_t bytes, size_t alignment)
+		{
+			m_counters.allocations++;
+			m_counters.bytes += bytes;
+
+			return m_upstream->allocate(bytes, alignment);
+		}
+
+		void CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+		{
+			m_upstream->deallocate(pointer, bytes, alignment);
+		}
+
+		bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+		{
+			return this == &other;
+		}
+	}
+}
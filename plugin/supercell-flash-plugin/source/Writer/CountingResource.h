@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace sc {
+	namespace Adobe {
+		// Memory resource that passes everything to upstream resource and counts allocations
+		// Counters are atomic, so one set of counters can be shared by resources of many workers
+		class CountingResource : public std::pmr::memory_resource
+		{
+		public:
+			struct Counters
+			{
+				std::atomic<size_t> allocations = 0;
+				std::atomic<size_t> bytes = 0;
+			};
+
+		public:
+			CountingResource(Counters& counters, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+				m_counters(counters), m_upstream(upstream)
+			{
+			}
+
+		protected:
+			virtual void* do_allocate(size_t bytes, size_t alignment) override;
+			virtual void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+			virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		private:
+			Counters& m_counters;
+			std::pmr::memory_resource* m_upstream;
+		};
+	}
+}
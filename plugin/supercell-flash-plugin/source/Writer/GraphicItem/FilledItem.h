@@ -3,6 +3,8 @@
 #include "AnimatePublisher.h"
 #include "GraphicItem.h"
 
+#include <memory_resource>
+
 namespace sc
 {
 	namespace Adobe
@@ -13,17 +15,29 @@ namespace sc
 			using Point = Animate::Publisher::Point2D;
 
 		public:
-			FilledItemContour(const std::vector<Point>& contour) : m_contour(contour)
+			FilledItemContour(const std::vector<Point>& contour, std::pmr::memory_resource* memory) :
+				m_contour(contour.begin(), contour.end(), memory)
+			{
+			}
+
+			FilledItemContour(std::pmr::vector<Point>&& contour) : m_contour(std::move(contour))
 			{
 			}
 
-			const std::vector<Point>& Contour() const
+			// Copy stays in memory of source, plain vector copy would go to default resource
+			FilledItemContour(const FilledItemContour& other) : m_contour(other.m_contour, other.m_contour.get_allocator())
+			{
+			}
+
+			FilledItemContour(FilledItemContour&&) = default;
+
+			const std::pmr::vector<Point>& Contour() const
 			{
 				return m_contour;
 			}
 
 		public:
-			const std::vector<Point> m_contour;
+			std::pmr::vector<Point> m_contour;
 		};
 
 		// Class that represents simple filled contour
@@ -62,7 +76,8 @@ namespace sc
 				return m_color;
 			}
 
-			const std::vector<FilledItemContour> contours;
+			// Triangulated items are filled by writer when their job is done
+			std::vector<FilledItemContour> contours;
 
 		private:
 			wk::ColorRGBA m_color;
@@ -6,15 +6,38 @@ namespace sc
 	{
 		SlicedItem::SlicedItem(
 			Animate::Publisher::SymbolContext& context,
-			wk::RawImageRef image, 
+			const HashedImage& image,
 			const Animate::DOM::Utils::MATRIX2D& matrix,
 			const wk::Point& translation,
-			const Animate::DOM::Utils::RECT& guides
-		) : BitmapItem(context), m_translation(translation)
+			const Animate::DOM::Utils::RECT& guides,
+			wk::Ref<SlicedSource> source
+		) : BitmapItem(context), m_translation(translation), m_slice_source(source)
 		{
 			m_matrix = matrix;
-			m_image = image;
+			m_image = image.image;
+			m_image_hash = image.hash;
 			m_guides = SlicedItem::RoundScalingGrid(guides);
+
+			if (m_slice_source)
+			{
+				m_resolution = m_slice_source->resolution;
+			}
+		}
+
+		void SlicedItem::Replace(
+			const HashedImage& image,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			const wk::Point& translation,
+			const Animate::DOM::Utils::RECT& guides,
+			float resolution
+		)
+		{
+			m_image = image.image;
+			m_image_hash = image.hash;
+			m_matrix = matrix;
+			m_translation = translation;
+			m_guides = SlicedItem::RoundScalingGrid(guides);
+			m_resolution = resolution;
 		}
 
 		wk::Rect SlicedItem::RoundScalingGrid(const Animate::DOM::Utils::RECT& guides)
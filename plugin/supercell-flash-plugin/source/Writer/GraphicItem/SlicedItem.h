@@ -8,15 +8,34 @@ namespace sc
 {
 	namespace Adobe
 	{
+		// Vector elements of rasterized 9-slice sprite, kept to draw it again with another resolution
+		struct SlicedSource
+		{
+			// Drawn regions of elements with their own transformation already applied
+			std::vector<RasterRegion> regions;
+
+			// Bound of elements with their strokes
+			Animate::DOM::Utils::RECT bound;
+
+			Animate::DOM::Utils::RECT guides;
+
+			// Resolution of the first drawing, items keep their current resolution themselves
+			float resolution = 1.f;
+
+			// Hash of regions and guides, equal for the same slice in any symbol
+			uint64_t key = 0;
+		};
+
 		class SlicedItem : public BitmapItem
 		{
 		public:
 			SlicedItem(
 				Animate::Publisher::SymbolContext& context,
-				wk::RawImageRef image,
+				const HashedImage& image,
 				const Animate::DOM::Utils::MATRIX2D& matrix,
 				const wk::Point& translation,
-				const Animate::DOM::Utils::RECT& guides
+				const Animate::DOM::Utils::RECT& guides,
+				wk::Ref<SlicedSource> source = nullptr
 			);
 
 		public:
@@ -37,9 +56,27 @@ namespace sc
 
 			static wk::Rect RoundScalingGrid(const Animate::DOM::Utils::RECT&);
 
+			// Vector source or nullptr if sprite can't be drawn again
+			const wk::Ref<SlicedSource>& SliceSource() const
+			{
+				return m_slice_source;
+			}
+
+			/// <summary>
+			/// Replaces sprite with the same one drawn with another resolution
+			/// </summary>
+			void Replace(
+				const HashedImage& image,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				const wk::Point& translation,
+				const Animate::DOM::Utils::RECT& guides,
+				float resolution
+			);
+
 		private:
 			wk::Point m_translation;
 			wk::Rect m_guides;
+			wk::Ref<SlicedSource> m_slice_source;
 		};
 	}
 }
\ No newline at end of file
@@ -1,22 +1,56 @@
 #include "SpriteItem.h"
 
+#include "core/hashing/ncrypto/xxhash.h"
+#include "core/hashing/hash.h"
+
 namespace sc
 {
 	namespace Adobe
 	{
+		HashedImage::HashedImage(wk::RawImageRef image) : image(image)
+		{
+			wk::hash::XxHash code;
+			code.update((const wk::Image&)*image);
+
+			hash = code.digest();
+		}
+
 		BitmapItem::BitmapItem(
 			Animate::Publisher::SymbolContext& context,
-			wk::RawImageRef image,
+			const HashedImage& image,
 			const Animate::DOM::Utils::MATRIX2D& matrix,
 			bool rasterized
-		) : GraphicItem(context), m_image(image), m_is_rasterized(rasterized)
+		) : GraphicItem(context), m_image(image.image), m_image_hash(image.hash), m_is_rasterized(rasterized)
 		{
 			m_matrix = matrix;
 		};
 
+		BitmapItem::BitmapItem(
+			Animate::Publisher::SymbolContext& context,
+			const HashedImage& image,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			wk::Ref<RasterizedSource> source
+		) : GraphicItem(context), m_image(image.image), m_image_hash(image.hash), m_is_rasterized(true), m_source(source)
+		{
+			m_matrix = matrix;
+
+			if (m_source)
+			{
+				m_resolution = m_source->resolution;
+			}
+		};
+
 		BitmapItem::BitmapItem(Animate::Publisher::SymbolContext& context) : GraphicItem(context)
 		{
 
 		}
+
+		void BitmapItem::Replace(const HashedImage& image, const Animate::DOM::Utils::MATRIX2D& matrix, float resolution)
+		{
+			m_image = image.image;
+			m_image_hash = image.hash;
+			m_matrix = matrix;
+			m_resolution = resolution;
+		}
 	}
 }
\ No newline at end of file
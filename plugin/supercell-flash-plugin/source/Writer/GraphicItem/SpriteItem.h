@@ -12,16 +12,88 @@ namespace sc
 {
 	namespace Adobe
 	{
+		// Image with hash of its content
+		// Hash is computed once when image is created, so items that share image don't hash its pixels again
+		struct HashedImage
+		{
+			HashedImage() = default;
+			HashedImage(wk::RawImageRef image);
+
+			wk::RawImageRef image;
+			uint64_t hash = 0;
+		};
+
+		// Region path as plain points, so it can be drawn without DOM objects
+		struct RasterPath
+		{
+			enum class Verb : uint8_t
+			{
+				// Takes one point
+				Move,
+				Line,
+
+				// Takes control and end points
+				Quad,
+				Cubic
+			};
+
+			std::vector<Verb> verbs;
+			std::vector<Animate::Publisher::Point2D> points;
+		};
+
+		// Filled region with everything read from DOM on publishing thread
+		// Workers draw it and release it, so it must not own any DOM object
+		struct RasterRegion
+		{
+			Animate::Publisher::FilledElementRegion::ShapeType type;
+
+			RasterPath contour;
+			std::vector<RasterPath> holes;
+			Animate::DOM::Utils::RECT bound;
+
+			// Solid fill only
+			Animate::DOM::Utils::COLOR color;
+
+			// Bitmap fill only, premultiplied RGBA8 texture and its pattern matrix in pixels
+			wk::RawImageRef bitmap;
+			uint64_t bitmap_hash = 0;
+			Animate::DOM::Utils::MATRIX2D bitmap_matrix;
+		};
+
+		// Vector regions of rasterized sprite
+		// Kept to draw sprite again when its shape turns out to be displayed with another scale
+		struct RasterizedSource
+		{
+			// Regions in draw order
+			std::vector<RasterRegion> regions;
+
+			Animate::DOM::Utils::MATRIX2D matrix;
+
+			// Resolution of the first drawing, items keep their current resolution themselves
+			float resolution = 1.f;
+
+			// Hash of regions relative to their bound. Matrix is applied only to drawn sprite,
+			// so the same artwork has the same key under any matrix and resolution.
+			uint64_t key = 0;
+		};
+
 		class BitmapItem : public GraphicItem
 		{
 		public:
 			BitmapItem(
 				Animate::Publisher::SymbolContext& context,
-				wk::RawImageRef image,
+				const HashedImage& image,
 				const Animate::DOM::Utils::MATRIX2D& matrix,
 				bool rasterized = false
 			);
 
+			BitmapItem(
+				Animate::Publisher::SymbolContext& context,
+				const HashedImage& image,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				wk::Ref<RasterizedSource> source
+			);
+
 			BitmapItem(Animate::Publisher::SymbolContext& context);
 
 			virtual ~BitmapItem() = default;
@@ -29,6 +101,9 @@ namespace sc
 		public:
 			virtual const wk::RawImage& Image() const { return *m_image; }
 
+			// Content hash of image
+			uint64_t ImageHash() const { return m_image_hash; }
+
 			virtual bool IsSprite() const
 			{
 				return true;
@@ -36,9 +111,23 @@ namespace sc
 
 			bool IsRasterizedVector() const { return m_is_rasterized; }
 
+			// Vector source or nullptr if sprite can't be drawn again
+			const wk::Ref<RasterizedSource>& Source() const { return m_source; }
+
+			// Resolution of current image. Source may be shared, so it is stored per item.
+			float Resolution() const { return m_resolution; }
+
+			/// <summary>
+			/// Replaces sprite with the same one drawn with another resolution
+			/// </summary>
+			void Replace(const HashedImage& image, const Animate::DOM::Utils::MATRIX2D& matrix, float resolution);
+
 		protected:
 			wk::RawImageRef m_image;
+			uint64_t m_image_hash = 0;
 			bool m_is_rasterized = false;
+			wk::Ref<RasterizedSource> m_source;
+			float m_resolution = 1.f;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "JobPool.h"
+
+namespace sc {
+	namespace Adobe {
+		JobPool::JobPool(size_t thread_count)
+		{
+			thread_count = std::max<size_t>(thread_count, 1);
+
+			m_threads.reserve(thread_count);
+			for (size_t i = 0; thread_count > i; i++)
+			{
+				m_threads.emplace_back(&JobPool::Worker, this);
+			}
+		}
+
+		JobPool::~JobPool()
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				m_stopping = true;
+			}
+
+			m_condition.notify_all();
+
+			for (std::thread& thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		void JobPool::Worker()
+		{
+			while (true)
+			{
+				std::function<void()> job;
+
+				{
+					std::unique_lock lock(m_mutex);
+					m_condition.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+
+					// Queue is drained before stopping so no future is left without result
+					if (m_queue.empty()) return;
+
+					job = std::move(m_queue.front());
+					m_queue.pop();
+				}
+
+				m_active_jobs++;
+				job();
+				m_active_jobs--;
+			}
+		}
+	}
+}
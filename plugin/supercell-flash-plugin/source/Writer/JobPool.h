@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sc {
+	namespace Adobe {
+		// Fixed size pool of worker threads for heavy CPU work like rasterization and triangulation
+		// Jobs must not touch Animate DOM, it can be used only from publishing thread
+		class JobPool
+		{
+		public:
+			JobPool(size_t thread_count = JobPool::Concurrency());
+			~JobPool();
+
+			JobPool(const JobPool&) = delete;
+			JobPool& operator=(const JobPool&) = delete;
+
+		public:
+			// Count of threads used for parallel work of publisher
+			static size_t Concurrency()
+			{
+				return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+
+			/// <summary>
+			/// Threads that one more parallel task may use without oversubscribing CPU with running jobs.
+			/// Taken when task starts, so it reflects pool load at that moment.
+			/// </summary>
+			size_t ThreadBudget() const
+			{
+				return std::max<size_t>(JobPool::Concurrency() / std::max<size_t>(m_active_jobs.load(), 1), 1);
+			}
+
+		public:
+			/// <summary>
+			/// Queues job for execution on one of workers
+			/// </summary>
+			/// <returns>Future with job result. Exceptions of job are rethrown from future.</returns>
+			template<typename F>
+			std::future<std::invoke_result_t<F>> Submit(F&& function)
+			{
+				using Result = std::invoke_result_t<F>;
+
+				auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+				std::future<Result> result = task->get_future();
+
+				{
+					std::lock_guard lock(m_mutex);
+					m_queue.emplace([task]() { (*task)(); });
+				}
+
+				m_condition.notify_one();
+				return result;
+			}
+
+		private:
+			void Worker();
+
+		private:
+			std::vector<std::thread> m_threads;
+			std::queue<std::function<void()>> m_queue;
+
+			std::mutex m_mutex;
+			std::condition_variable m_condition;
+			bool m_stopping = false;
+
+			// Jobs that are executed right now
+			std::atomic<size_t> m_active_jobs = 0;
+		};
+	}
+}
@@ -236,7 +236,9 @@ namespace sc {
 			//if (!new_symbol) return true;
 
 			FinalizeTransforms();
-			m_writer.swf.movieclips.push_back(m_object);
+
+			// Object is not used by this writer anymore
+			m_writer.swf.movieclips.push_back(std::move(m_object));
 
 			return true;
 		}
@@ -246,7 +248,7 @@ namespace sc {
 			{
 			CREATE_NEW_BANK:
 				m_object.bank_index = m_writer.swf.matrixBanks.size();
-				m_writer.swf.matrixBanks.push_back(m_bank);
+				m_writer.swf.matrixBanks.push_back(std::move(m_bank));
 				return;
 			}
 			
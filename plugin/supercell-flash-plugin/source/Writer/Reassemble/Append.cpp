@@ -0,0 +1,302 @@
+#include "Append.h"
+
+using namespace wk;
+
+namespace sc::flash
+{
+	void blit_image(RawImage& page, uint16_t x, uint16_t y, const RawImage& image, bool premultiply)
+	{
+		const RawImage* source = &image;
+		RawImageRef converted;
+		if (image.depth() != Image::PixelDepth::RGBA8)
+		{
+			converted = CreateRef<RawImage>(image.width(), image.height(), Image::PixelDepth::RGBA8);
+			RawImage::remap(image.data(), converted->data(), image.width(), image.height(), image.depth(), converted->depth());
+			source = converted.get();
+		}
+
+		const ColorRGBA* source_pixels = (const ColorRGBA*)source->data();
+		ColorRGBA* page_pixels = (ColorRGBA*)page.data();
+
+		for (uint16_t h = 0; source->height() > h; h++)
+		{
+			const ColorRGBA* source_row = source_pixels + (size_t)h * source->width();
+			ColorRGBA* page_row = page_pixels + (size_t)(y + h) * page.width() + x;
+
+			if (!premultiply)
+			{
+				std::memcpy(page_row, source_row, sizeof(ColorRGBA) * source->width());
+				continue;
+			}
+
+			for (uint16_t w = 0; source->width() > w; w++)
+			{
+				ColorRGBA pixel = source_row[w];
+				float alpha = (float)pixel.a / 255.f;
+
+				pixel.r = (uint8_t)(pixel.r * alpha);
+				pixel.g = (uint8_t)(pixel.g * alpha);
+				pixel.b = (uint8_t)(pixel.b * alpha);
+
+				page_row[w] = pixel;
+			}
+		}
+	}
+
+	void fill_color(RawImage& page, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const ColorRGBA& color)
+	{
+		float alpha = (float)color.a / 255.f;
+		ColorRGBA pixel(
+			(uint8_t)(color.r * alpha),
+			(uint8_t)(color.g * alpha),
+			(uint8_t)(color.b * alpha),
+			color.a
+		);
+
+		ColorRGBA* page_pixels = (ColorRGBA*)page.data();
+		for (uint16_t h = 0; height > h; h++)
+		{
+			ColorRGBA* row = page_pixels + (size_t)(y + h) * page.width() + x;
+			std::fill(row, row + width, pixel);
+		}
+	}
+
+	AtlasAppender::AtlasAppender(SupercellSWF& swf, size_t page_count, uint8_t padding) : m_swf(swf), m_padding(padding)
+	{
+		page_count = std::min(page_count, swf.textures.size());
+		m_pages.resize(page_count);
+
+		for (size_t i = 0; page_count > i; i++)
+		{
+			Page& page = m_pages[i];
+			const SWFTexture& texture = swf.textures[i];
+
+			page.width = (uint16_t)texture.image()->width();
+			page.height = (uint16_t)texture.image()->height();
+			page.writable = texture.image()->base_type() == Image::BasePixelType::RGBA;
+			page.free_rects.push_back(Rect{ 0, 0, page.width, page.height });
+		}
+
+		// Everything that is still referenced by shapes is occupied space
+		for (const Shape& shape : swf.shapes)
+		{
+			for (const ShapeDrawBitmapCommand& command : shape.commands)
+			{
+				if (command.texture_index >= m_pages.size() || command.vertices.empty()) continue;
+
+				Page& page = m_pages[command.texture_index];
+				if (!page.writable) continue;
+
+				float min_u = std::numeric_limits<float>::max();
+				float min_v = std::numeric_limits<float>::max();
+				float max_u = std::numeric_limits<float>::lowest();
+				float max_v = std::numeric_limits<float>::lowest();
+
+				for (const ShapeDrawBitmapCommandVertex& vertex : command.vertices)
+				{
+					min_u = std::min(vertex.u, min_u);
+					min_v = std::min(vertex.v, min_v);
+					max_u = std::max(vertex.u, max_u);
+					max_v = std::max(vertex.v, max_v);
+				}
+
+				int left = (int)std::floor(min_u * page.width) - m_padding;
+				int top = (int)std::floor(min_v * page.height) - m_padding;
+				int right = (int)std::ceil(max_u * page.width) + m_padding;
+				int bottom = (int)std::ceil(max_v * page.height) + m_padding;
+
+				left = std::clamp(left, 0, (int)page.width);
+				top = std::clamp(top, 0, (int)page.height);
+				right = std::clamp(right, left + 1, (int)page.width);
+				bottom = std::clamp(bottom, top + 1, (int)page.height);
+
+				occupy(page, Rect{ left, top, right - left, bottom - top });
+			}
+		}
+	}
+
+	std::optional<AtlasAppender::Placement> AtlasAppender::insert(const RawImage& image, bool premultiply)
+	{
+		std::optional<Placement> placement = allocate(image.width(), image.height());
+		if (!placement.has_value()) return std::nullopt;
+
+		RawImage& page = page_image(placement->texture_index);
+		blit_image(page, placement->x, placement->y, image, premultiply);
+
+		return placement;
+	}
+
+	std::optional<AtlasAppender::Placement> AtlasAppender::insert(const ColorRGBA& color)
+	{
+		const uint16_t block_size = 3;
+
+		std::optional<Placement> placement = allocate(block_size, block_size);
+		if (!placement.has_value()) return std::nullopt;
+
+		RawImage& page = page_image(placement->texture_index);
+		fill_color(page, placement->x, placement->y, block_size, block_size, color);
+
+		placement->x += block_size / 2;
+		placement->y += block_size / 2;
+
+		return placement;
+	}
+
+	bool AtlasAppender::is_touched(size_t texture_index) const
+	{
+		if (texture_index >= m_pages.size()) return false;
+
+		return m_pages[texture_index].touched;
+	}
+
+	size_t AtlasAppender::touched_count() const
+	{
+		return std::count_if(m_pages.begin(), m_pages.end(), [](const Page& page) { return page.touched; });
+	}
+
+	void AtlasAppender::finalize()
+	{
+		for (size_t i = 0; m_pages.size() > i; i++)
+		{
+			Page& page = m_pages[i];
+			if (!page.touched || !page.image) continue;
+
+			m_swf.textures[i].load_from_image(*page.image);
+			page.image.reset();
+		}
+	}
+
+	std::optional<AtlasAppender::Placement> AtlasAppender::allocate(uint16_t width, uint16_t height)
+	{
+		const int reserved_width = width + m_padding * 2;
+		const int reserved_height = height + m_padding * 2;
+
+		// Best short side fit through all pages
+		size_t best_page = SIZE_MAX;
+		Rect best_rect;
+		int best_score = std::numeric_limits<int>::max();
+
+		for (size_t i = 0; m_pages.size() > i; i++)
+		{
+			const Page& page = m_pages[i];
+			if (!page.writable) continue;
+
+			for (const Rect& rect : page.free_rects)
+			{
+				if (reserved_width > rect.width || reserved_height > rect.height) continue;
+
+				int score = std::min(rect.width - reserved_width, rect.height - reserved_height);
+				if (best_score > score)
+				{
+					best_score = score;
+					best_page = i;
+					best_rect = rect;
+				}
+			}
+		}
+
+		if (best_page == SIZE_MAX) return std::nullopt;
+
+		Page& page = m_pages[best_page];
+		Rect used{ best_rect.x, best_rect.y, reserved_width, reserved_height };
+		occupy(page, used);
+
+		// Free space can still contain pixels of removed sprites so padding must be cleared too
+		RawImage& image = page_image(best_page);
+		ColorRGBA* pixels = (ColorRGBA*)image.data();
+		for (int h = 0; used.height > h; h++)
+		{
+			ColorRGBA* row = pixels + (size_t)(used.y + h) * image.width() + used.x;
+			std::fill(row, row + used.width, ColorRGBA(0, 0, 0, 0));
+		}
+
+		page.touched = true;
+
+		return Placement{
+			(uint16_t)best_page,
+			(uint16_t)(used.x + m_padding),
+			(uint16_t)(used.y + m_padding)
+		};
+	}
+
+	void AtlasAppender::occupy(Page& page, const Rect& used)
+	{
+		std::vector<Rect> splitted;
+		splitted.reserve(page.free_rects.size() + 4);
+
+		// MaxRects split: every free rect that intersects used area is replaced by its maximal remainders
+		for (const Rect& rect : page.free_rects)
+		{
+			if (!rect.intersects(used))
+			{
+				splitted.push_back(rect);
+				continue;
+			}
+
+			if (used.x > rect.x)
+			{
+				splitted.push_back(Rect{ rect.x, rect.y, used.x - rect.x, rect.height });
+			}
+
+			if (rect.x + rect.width > used.x + used.width)
+			{
+				int x = used.x + used.width;
+				splitted.push_back(Rect{ x, rect.y, rect.x + rect.width - x, rect.height });
+			}
+
+			if (used.y > rect.y)
+			{
+				splitted.push_back(Rect{ rect.x, rect.y, rect.width, used.y - rect.y });
+			}
+
+			if (rect.y + rect.height > used.y + used.height)
+			{
+				int y = used.y + used.height;
+				splitted.push_back(Rect{ rect.x, y, rect.width, rect.y + rect.height - y });
+			}
+		}
+
+		// Remove rects that are fully covered by others
+		page.free_rects.clear();
+		for (size_t i = 0; splitted.size() > i; i++)
+		{
+			bool covered = false;
+			for (size_t t = 0; splitted.size() > t; t++)
+			{
+				if (i == t) continue;
+
+				if (splitted[t].contains(splitted[i]) && (t < i || !splitted[i].contains(splitted[t])))
+				{
+					covered = true;
+					break;
+				}
+			}
+
+			if (!covered)
+			{
+				page.free_rects.push_back(splitted[i]);
+			}
+		}
+	}
+
+	RawImage& AtlasAppender::page_image(size_t index)
+	{
+		Page& page = m_pages[index];
+
+		if (!page.image)
+		{
+			Ref<RawImage> image = m_swf.textures[index].raw_image();
+
+			if (image->depth() != Image::PixelDepth::RGBA8)
+			{
+				Ref<RawImage> converted = CreateRef<RawImage>(image->width(), image->height(), Image::PixelDepth::RGBA8);
+				RawImage::remap(image->data(), converted->data(), image->width(), image->height(), image->depth(), converted->depth());
+				image = converted;
+			}
+
+			page.image = image;
+		}
+
+		return *page.image;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "flash/flash.h"
+#include "atlas_generator/Generator.h"
+#include "core/memory/ref.h"
+#include "core/image/raw_image.h"
+
+#include <optional>
+
+namespace sc::flash
+{
+	// Copies image to RGBA8 page at given position
+	void blit_image(wk::RawImage& page, uint16_t x, uint16_t y, const wk::RawImage& image, bool premultiply);
+
+	// Fills RGBA8 page area with premultiplied color
+	void fill_color(wk::RawImage& page, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const wk::ColorRGBA& color);
+
+	// Places new sprites into free space of texture pages loaded from external file
+	// Pages that never receive anything keep their original encoded data untouched
+	class AtlasAppender
+	{
+	public:
+		struct Placement
+		{
+			// Index of texture in swf
+			uint16_t texture_index = 0;
+
+			// Top left corner of placed content (without padding)
+			uint16_t x = 0;
+			uint16_t y = 0;
+		};
+
+	public:
+		AtlasAppender(SupercellSWF& swf, size_t page_count, uint8_t padding = 2);
+
+	public:
+		/// <summary>
+		/// Reserves space for image and copies its pixels to texture page
+		/// </summary>
+		/// <param name="image">Sprite image</param>
+		/// <param name="premultiply">Premultiply alpha while copying</param>
+		/// <returns>Placement or nothing if there is no suitable free space</returns>
+		std::optional<Placement> insert(const wk::RawImage& image, bool premultiply);
+
+		/// <summary>
+		/// Reserves small solid block for colorfill. Placement points to block center.
+		/// </summary>
+		std::optional<Placement> insert(const wk::ColorRGBA& color);
+
+		bool is_touched(size_t texture_index) const;
+		size_t touched_count() const;
+
+		/// <summary>
+		/// Loads modified pages back to their textures
+		/// </summary>
+		void finalize();
+
+	private:
+		struct Rect
+		{
+			int x = 0;
+			int y = 0;
+			int width = 0;
+			int height = 0;
+
+			bool contains(const Rect& other) const
+			{
+				return other.x >= x && other.y >= y &&
+					other.x + other.width <= x + width &&
+					other.y + other.height <= y + height;
+			}
+
+			bool intersects(const Rect& other) const
+			{
+				return other.x < x + width && other.x + other.width > x &&
+					other.y < y + height && other.y + other.height > y;
+			}
+		};
+
+		struct Page
+		{
+			uint16_t width = 0;
+			uint16_t height = 0;
+
+			// Only RGBA pages can receive new sprites without loss
+			bool writable = false;
+			bool touched = false;
+
+			std::vector<Rect> free_rects;
+			wk::RawImageRef image;
+		};
+
+	private:
+		std::optional<Placement> allocate(uint16_t width, uint16_t height);
+		void occupy(Page& page, const Rect& used);
+		wk::RawImage& page_image(size_t index);
+
+	private:
+		SupercellSWF& m_swf;
+		uint8_t m_padding;
+		std::vector<Page> m_pages;
+	};
+}
@@ -0,0 +1,133 @@
+#include "Shelf.h"
+
+using namespace wk;
+
+namespace sc::flash
+{
+	ShelfPacker::ShelfPacker(uint16_t width, uint16_t height, uint8_t padding) : m_width(width), m_height(height), m_padding(padding)
+	{
+	}
+
+	std::optional<ShelfPacker::Placement> ShelfPacker::insert(const RawImage& image, bool premultiply)
+	{
+		std::optional<Placement> placement = allocate(image.width(), image.height());
+		if (!placement.has_value()) return std::nullopt;
+
+		RawImage& page = *m_pages[placement->texture_index].image;
+		blit_image(page, placement->x, placement->y, image, premultiply);
+
+		return placement;
+	}
+
+	std::optional<ShelfPacker::Placement> ShelfPacker::insert(const ColorRGBA& color)
+	{
+		const uint16_t block_size = 3;
+
+		std::optional<Placement> placement = allocate(block_size, block_size);
+		if (!placement.has_value()) return std::nullopt;
+
+		RawImage& page = *m_pages[placement->texture_index].image;
+		fill_color(page, placement->x, placement->y, block_size, block_size, color);
+
+		placement->x += block_size / 2;
+		placement->y += block_size / 2;
+
+		return placement;
+	}
+
+	std::vector<RawImageRef> ShelfPacker::finalize()
+	{
+		std::vector<RawImageRef> result;
+		result.reserve(m_pages.size());
+
+		for (Page& page : m_pages)
+		{
+			if (page.used_width == m_width && page.used_height == m_height)
+			{
+				result.push_back(page.image);
+				continue;
+			}
+
+			RawImageRef cropped = CreateRef<RawImage>(page.used_width, page.used_height, Image::PixelDepth::RGBA8);
+			for (uint16_t h = 0; page.used_height > h; h++)
+			{
+				std::memcpy(
+					cropped->data() + (size_t)h * page.used_width * sizeof(ColorRGBA),
+					page.image->data() + (size_t)h * m_width * sizeof(ColorRGBA),
+					(size_t)page.used_width * sizeof(ColorRGBA)
+				);
+			}
+
+			result.push_back(cropped);
+		}
+
+		m_pages.clear();
+
+		return result;
+	}
+
+	std::optional<ShelfPacker::Placement> ShelfPacker::allocate(uint16_t width, uint16_t height)
+	{
+		const int reserved_width = width + m_padding * 2;
+		const int reserved_height = height + m_padding * 2;
+
+		if (reserved_width > m_width || reserved_height > m_height) return std::nullopt;
+
+		if (m_pages.empty())
+		{
+			create_page();
+		}
+
+		// Only the last page is open, previous ones are considered full
+		size_t page_index = m_pages.size() - 1;
+		Page* page = &m_pages[page_index];
+
+		// Shelf with the least height waste that still has enough free width
+		Shelf* target = nullptr;
+		for (Shelf& shelf : page->shelves)
+		{
+			if (reserved_height > shelf.height || reserved_width > m_width - shelf.x) continue;
+
+			if (!target || target->height > shelf.height)
+			{
+				target = &shelf;
+			}
+		}
+
+		if (!target)
+		{
+			uint16_t shelf_y = page->shelves.empty() ? 0 : page->shelves.back().y + page->shelves.back().height;
+			if (reserved_height > m_height - shelf_y)
+			{
+				page = &create_page();
+				page_index++;
+				shelf_y = 0;
+			}
+
+			target = &page->shelves.emplace_back();
+			target->y = shelf_y;
+			target->height = (uint16_t)reserved_height;
+		}
+
+		Placement placement{
+			(uint16_t)page_index,
+			(uint16_t)(target->x + m_padding),
+			(uint16_t)(target->y + m_padding)
+		};
+
+		target->x += (uint16_t)reserved_width;
+		page->used_width = std::max(page->used_width, target->x);
+		page->used_height = std::max(page->used_height, (uint16_t)(target->y + target->height));
+
+		return placement;
+	}
+
+	ShelfPacker::Page& ShelfPacker::create_page()
+	{
+		Page& page = m_pages.emplace_back();
+		page.image = CreateRef<RawImage>(m_width, m_height, Image::PixelDepth::RGBA8);
+		std::memset(page.image->data(), 0, (size_t)m_width * m_height * sizeof(ColorRGBA));
+
+		return page;
+	}
+}
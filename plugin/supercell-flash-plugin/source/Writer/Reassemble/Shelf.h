@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Append.h"
+
+#include <optional>
+#include <vector>
+
+namespace sc::flash
+{
+	// Fast atlas packer that puts rectangles on horizontal shelves of new texture pages
+	// Gives worse density than polygon nesting but works in linear time
+	class ShelfPacker
+	{
+	public:
+		// Texture index of placement is index of page in this packer
+		using Placement = AtlasAppender::Placement;
+
+	public:
+		ShelfPacker(uint16_t width, uint16_t height, uint8_t padding = 2);
+
+	public:
+		/// <summary>
+		/// Reserves space for image and copies its pixels to page
+		/// </summary>
+		/// <param name="image">Sprite image</param>
+		/// <param name="premultiply">Premultiply alpha while copying</param>
+		/// <returns>Placement or nothing if image is bigger than page</returns>
+		std::optional<Placement> insert(const wk::RawImage& image, bool premultiply);
+
+		/// <summary>
+		/// Reserves small solid block for colorfill. Placement points to block center.
+		/// </summary>
+		std::optional<Placement> insert(const wk::ColorRGBA& color);
+
+		size_t page_count() const
+		{
+			return m_pages.size();
+		}
+
+		/// <summary>
+		/// Returns all pages cropped to their used area
+		/// </summary>
+		std::vector<wk::RawImageRef> finalize();
+
+	private:
+		struct Shelf
+		{
+			uint16_t y = 0;
+			uint16_t height = 0;
+
+			// Start of free space
+			uint16_t x = 0;
+		};
+
+		struct Page
+		{
+			wk::RawImageRef image;
+			std::vector<Shelf> shelves;
+
+			uint16_t used_width = 0;
+			uint16_t used_height = 0;
+		};
+
+	private:
+		std::optional<Placement> allocate(uint16_t width, uint16_t height);
+		Page& create_page();
+
+	private:
+		uint16_t m_width;
+		uint16_t m_height;
+		uint8_t m_padding;
+
+		std::vector<Page> m_pages;
+	};
+}
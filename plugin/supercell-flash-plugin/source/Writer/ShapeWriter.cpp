@@ -1,9 +1,16 @@
 #include "Writer.h"
 #include "ShapeWriter.h"
 #include "Module/Module.h"
+#include "Writer/SynchronizedArena.h"
 
 #include <CDT.h>
 
+#include <array>
+#include <map>
+#include <memory_resource>
+#include <numeric>
+#include <unordered_map>
+
 #include "core/hashing/ncrypto/xxhash.h"
 #include "core/hashing/hash.h"
 #include "core/stb/stb.h"
@@ -22,97 +29,337 @@ namespace sc {
 			}
 		}
 
+		// Normalized bounding box of region
+		struct RegionBound
+		{
+			float left = 0.f;
+			float top = 0.f;
+			float right = 0.f;
+			float bottom = 0.f;
+
+			RegionBound() = default;
+			RegionBound(const Animate::DOM::Utils::RECT& rect)
+			{
+				left = std::min(rect.topLeft.x, rect.bottomRight.x);
+				top = std::min(rect.topLeft.y, rect.bottomRight.y);
+				right = std::max(rect.topLeft.x, rect.bottomRight.x);
+				bottom = std::max(rect.topLeft.y, rect.bottomRight.y);
+			}
+
+			bool Intersects(const RegionBound& other, float gap) const
+			{
+				return other.left <= right + gap && left <= other.right + gap &&
+					other.top <= bottom + gap && top <= other.bottom + gap;
+			}
+
+			RegionBound Union(const RegionBound& other) const
+			{
+				RegionBound result;
+				result.left = std::min(left, other.left);
+				result.top = std::min(top, other.top);
+				result.right = std::max(right, other.right);
+				result.bottom = std::max(bottom, other.bottom);
+
+				return result;
+			}
+		};
+
+		static bool IsSameMatrix(const Animate::DOM::Utils::MATRIX2D& first, const Animate::DOM::Utils::MATRIX2D& second)
+		{
+			return first.a == second.a && first.b == second.b &&
+				first.c == second.c && first.d == second.d &&
+				first.tx == second.tx && first.ty == second.ty;
+		}
+
 		void SCShapeWriter::AddGraphic(const Animate::Publisher::BitmapElement& item) {
-			wk::RawImageRef image = m_writer.GetBitmap(item);
+			ReleaseVectorGraphic();
+
+			HashedImage image = m_writer.GetBitmap(item);
+			auto matrix = item.Transformation();
+
+			m_group.AddElement<BitmapItem>(m_symbol, image, matrix);
+		}
 
-			m_group.AddElement<BitmapItem>(m_symbol, image, item.Transformation());
+		static bool IsSameColor(const Animate::DOM::Utils::COLOR& first, const Animate::DOM::Utils::COLOR& second)
+		{
+			return first.red == second.red && first.green == second.green &&
+				first.blue == second.blue && first.alpha == second.alpha;
+		}
+
+		// Convex contour turns to one side only and goes around once, so it can be drawn as fan right away
+		static bool IsConvexContour(const std::vector<Point2D>& points)
+		{
+			if (3 > points.size()) return false;
+
+			int turn_sign = 0;
+			int x_flips = 0;
+			int x_sign = 0;
+
+			for (size_t i = 0; points.size() > i; i++)
+			{
+				const Point2D& a = points[i];
+				const Point2D& b = points[(i + 1) % points.size()];
+				const Point2D& c = points[(i + 2) % points.size()];
+
+				float turn = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+				if (turn != 0.f)
+				{
+					int sign = turn > 0.f ? 1 : -1;
+					if (turn_sign != 0 && sign != turn_sign) return false;
+					turn_sign = sign;
+				}
+
+				// Star shaped contours turn to one side too, but change x direction more than twice
+				float dx = b.x - a.x;
+				if (dx != 0.f)
+				{
+					int sign = dx > 0.f ? 1 : -1;
+					if (x_sign != 0 && sign != x_sign) x_flips++;
+					x_sign = sign;
+				}
+			}
+
+			return turn_sign != 0 && x_flips <= 2;
+		}
+
+		// Appends closed polyline to triangulation input
+		static void AppendPath(const std::vector<Point2D>& points, std::pmr::vector<CDT::V2d<float>>& vertices, std::pmr::vector<CDT::Edge>& edges)
+		{
+			uint32_t first = (uint32_t)vertices.size();
+			for (uint32_t i = 0; points.size() > i; i++)
+			{
+				uint32_t second = i + 1 >= points.size() ? first : first + i + 1;
+				edges.push_back(CDT::Edge(first + i, second));
+			}
+
+			for (const Point2D& point : points)
+			{
+				vertices.push_back({ point.x, point.y });
+			}
 		}
 
 		void SCShapeWriter::AddFilledElement(const Animate::Publisher::FilledElement& shape) {
+			// Fills of one element never overlap, so abutting regions of the same color can be triangulated together
+			m_coalesce_regions = true;
 			for (const auto& region : shape.fill) {
 				AddFilledShapeRegion(region, shape.Transformation());
 			}
+			m_coalesce_regions = false;
+			ReleaseStraightRegions();
 
 			for (const auto& region : shape.stroke) {
-				AddFilledShapeRegion(region, shape.Transformation());
+				AddFilledShapeRegion(region, shape.Transformation(), true);
 			}
 		}
 
 		void SCShapeWriter::AddTriangulatedRegion(
-			const Animate::Publisher::FilledElementPath& contour,
-			const std::vector<Animate::Publisher::FilledElementPath>& holes,
+			const std::vector<Animate::Publisher::Point2D>& contour,
+			const std::vector<std::vector<Animate::Publisher::Point2D>>& holes,
 			const Animate::DOM::Utils::MATRIX2D& matrix,
 			const Animate::DOM::Utils::COLOR& color
 		){
-			CDT::Triangulation<float> cdt;
+			// Convex polygon of any size is a ready fan
+			if (holes.empty() && SCShapeWriter::MaxPolygonVertices >= contour.size() && IsConvexContour(contour))
+			{
+				m_writer.convex_fan_regions++;
 
-			std::vector<CDT::V2d<float>> vertices;
-			std::vector<CDT::Edge> edges;
+				std::vector<FilledItemContour> contours = { FilledItemContour(contour, m_writer.ContourMemory()) };
+				m_group.AddElement<FilledItem>(m_symbol, contours, color, matrix);
+				return;
+			}
 
-			{
-				std::vector<Animate::Publisher::Point2D> points;
-				contour.Rasterize(points);
+			std::pmr::vector<CDT::V2d<float>> vertices(InputMemory());
+			std::pmr::vector<CDT::Edge> edges(InputMemory());
 
-				for (Animate::Publisher::Point2D& point : points)
-				{
-					vertices.push_back({ point.x, point.y });
-				}
+			AppendPath(contour, vertices, edges);
+			for (const auto& points : holes) {
+				AppendPath(points, vertices, edges);
 			}
 
-			// Contour
-			for (uint32_t i = 0; vertices.size() > i; i++) {
-				uint32_t secondIndex = i + 1;
-				if (secondIndex >= vertices.size()) {
-					secondIndex = 0;
+			TriangulateAsync(std::move(vertices), std::move(edges), matrix, color, holes.empty() ? PolygonKind::Simple : PolygonKind::WithHoles);
+		}
+
+		void SCShapeWriter::AddCoalescedRegions(
+			const std::vector<const RegionGeometry*>& regions,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			const Animate::DOM::Utils::COLOR& color
+		)
+		{
+			std::pmr::vector<CDT::V2d<float>> vertices(InputMemory());
+			std::pmr::vector<CDT::Edge> edges(InputMemory());
+
+			for (const RegionGeometry* region : regions)
+			{
+				AppendPath(region->contour, vertices, edges);
+				for (const auto& points : region->holes) {
+					AppendPath(points, vertices, edges);
 				}
-				edges.push_back(CDT::Edge(i, secondIndex));
 			}
 
-			// Holes
-			for (const auto& hole : holes) {
-				std::vector<Animate::Publisher::Point2D> points;
-				hole.Rasterize(points);
+			TriangulateAsync(std::move(vertices), std::move(edges), matrix, color, PolygonKind::Coalesced);
+		}
 
-				for (uint32_t i = 0; points.size() > i; i++) {
-					uint32_t secondIndex = vertices.size() + i + 1;
-					if (secondIndex >= points.size() + vertices.size()) {
-						secondIndex = vertices.size();
-					}
-					edges.push_back(CDT::Edge(vertices.size() + i, secondIndex));
+		void SCShapeWriter::TriangulateAsync(
+			std::pmr::vector<CDT::V2d<float>>&& vertices,
+			std::pmr::vector<CDT::Edge>&& edges,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			const Animate::DOM::Utils::COLOR& color,
+			PolygonKind kind
+		)
+		{
+			SCWriter* writer = &m_writer;
+			TriangulationCache* cache = &m_writer.triangulation_cache;
+
+			// Shape hash can't wait for triangles, so it is taken from input that defines them
+			wk::hash::XxHash code;
+			code.update((uint8_t)kind);
+			code.update(color.red);
+			code.update(color.green);
+			code.update(color.blue);
+			code.update(color.alpha);
+			for (const CDT::V2d<float>& vertex : vertices)
+			{
+				code.update(vertex.x);
+				code.update(vertex.y);
+			}
+			for (const CDT::Edge& edge : edges)
+			{
+				code.update(edge.v1());
+				code.update(edge.v2());
+			}
+
+			// Input keeps arena of this shape alive until job is done, arena is declared first so it is destroyed last
+			struct Input
+			{
+				wk::Ref<SynchronizedArena> arena;
+				std::pmr::vector<CDT::V2d<float>> vertices;
+				std::pmr::vector<CDT::Edge> edges;
+			};
+
+			Input input{ m_input_arena, std::move(vertices), std::move(edges) };
+
+			std::future<std::vector<FilledItemContour>> job = m_writer.jobs.Submit([writer, cache, input = std::move(input), kind]() mutable -> std::vector<FilledItemContour> {
+				std::pmr::vector<CDT::V2d<float>>& vertices = input.vertices;
+				std::pmr::vector<CDT::Edge>& edges = input.edges;
+
+				size_t input_vertex_count = vertices.size();
+				CDT::RemoveDuplicatesAndRemapEdges<float>(
+					vertices,
+					[](const CDT::V2d<float>& vertex) { return vertex.x; },
+					[](const CDT::V2d<float>& vertex) { return vertex.y; },
+					edges.begin(), edges.end(),
+					[](const CDT::Edge& edge) { return edge.v1(); },
+					[](const CDT::Edge& edge) { return edge.v2(); },
+					[](CDT::VertInd start, CDT::VertInd end) { return CDT::Edge(start, end); }
+				);
+
+				if (kind == PolygonKind::Coalesced)
+				{
+					SCShapeWriter::RemoveSharedEdges(vertices, edges);
+
+					// Nothing is left if regions cancelled each other out
+					if (3 > vertices.size()) return {};
 				}
 
-				for (const auto& point : points) {
-					vertices.push_back({ point.x, point.y });
+				uint64_t key = SCShapeWriter::GetTriangulationKey(vertices, edges);
+
+				std::vector<TriangulationCache::Triangle> triangles;
+				if (!cache->Find(key, vertices.size(), triangles))
+				{
+					// Self-touching contour loses vertices on deduplication and is left for Delaunay triangulation
+					bool simple =
+						kind == PolygonKind::Simple &&
+						vertices.size() == input_vertex_count &&
+						SCShapeWriter::EarClippingMaxVertices >= vertices.size();
+
+					if (simple && SCShapeWriter::ClipEars(vertices, triangles))
+					{
+						writer->ear_clipped_regions++;
+						cache->Insert(key, vertices.size(), triangles);
+					}
+					else
+					{
+						triangles.clear();
+						writer->delaunay_regions++;
+
+						CDT::Triangulation<float> cdt;
+						cdt.insertVertices(
+							vertices.begin(), vertices.end(),
+							[](const CDT::V2d<float>& vertex) { return vertex.x; },
+							[](const CDT::V2d<float>& vertex) { return vertex.y; }
+						);
+						cdt.insertEdges(
+							edges.begin(), edges.end(),
+							[](const CDT::Edge& edge) { return edge.v1(); },
+							[](const CDT::Edge& edge) { return edge.v2(); }
+						);
+
+						cdt.eraseOuterTrianglesAndHoles();
+
+						for (const CDT::Triangle& triangle : cdt.triangles) {
+							triangles.push_back({
+								(uint32_t)triangle.vertices[0],
+								(uint32_t)triangle.vertices[1],
+								(uint32_t)triangle.vertices[2]
+							});
+						}
+
+						// Indices are valid for other geometry only if triangulation did not add any vertices
+						if (cdt.vertices.size() == vertices.size())
+						{
+							cache->Insert(key, vertices.size(), triangles);
+						}
+						else
+						{
+							vertices.assign(cdt.vertices.begin(), cdt.vertices.end());
+						}
+					}
 				}
-			}
 
-			CDT::RemoveDuplicatesAndRemapEdges(vertices, edges);
+				// Merging makes a lot of small temporary containers, so they live in arena of this job
+				// Arena is not shared between jobs, monotonic resource without lock is not thread safe
+				std::array<std::byte, SCShapeWriter::MergingArenaSize> arena_buffer;
+				std::pmr::monotonic_buffer_resource arena(arena_buffer.data(), arena_buffer.size(), &writer->shape_heap);
+				std::pmr::memory_resource* memory = writer->shape_arenas ? (std::pmr::memory_resource*)&arena : &writer->shape_heap;
 
-			cdt.insertVertices(vertices);
-			cdt.insertEdges(edges);
+				// Every triangle is a separate command padded to 4 vertices, so adjacent ones are merged into convex fans
+				std::pmr::vector<std::pmr::vector<uint32_t>> polygons(memory);
+				SCShapeWriter::MergeTriangles(vertices, triangles, polygons);
 
-			cdt.eraseOuterTrianglesAndHoles();
+				// Contours are kept until atlas is packed, so their points go to arena of writer
+				std::pmr::memory_resource* contour_memory = writer->ContourMemory();
 
-			std::vector<FilledItemContour> contours;
+				std::vector<FilledItemContour> contours;
+				contours.reserve(polygons.size());
+				size_t polygon_vertices = 0;
 
-			for (const CDT::Triangle& triangle : cdt.triangles) {
-				auto& point1 = cdt.vertices[triangle.vertices[0]];
-				auto& point2 = cdt.vertices[triangle.vertices[1]];
-				auto& point3 = cdt.vertices[triangle.vertices[2]];
+				for (const std::pmr::vector<uint32_t>& polygon : polygons) {
+					std::pmr::vector<Animate::Publisher::Point2D> polygon_shape(contour_memory);
+					polygon_shape.reserve(polygon.size());
 
-				std::vector<Animate::Publisher::Point2D> triangle_shape(
+					for (uint32_t index : polygon)
 					{
-						{point1.x, point1.y},
-						{point2.x, point2.y},
-						{point3.x, point3.y},
-						{point3.x, point3.y},
+						polygon_shape.push_back({ vertices[index].x, vertices[index].y });
 					}
-					);
 
-				contours.emplace_back(triangle_shape);
-			}
+					polygon_vertices += std::max<size_t>(polygon.size(), 4);
+					contours.emplace_back(std::move(polygon_shape));
+				}
 
-			m_group.AddElement<FilledItem>(m_symbol, contours, color, matrix);
+				writer->triangle_commands += triangles.size();
+				writer->triangle_vertices += triangles.size() * 4;
+				writer->polygon_commands += polygons.size();
+				writer->polygon_vertices += polygon_vertices;
+
+				return contours;
+			});
+
+			// Future is read once, so contours are moved to item and stay in arena
+			wk::Ref<std::future<std::vector<FilledItemContour>>> result = wk::CreateRef<std::future<std::vector<FilledItemContour>>>(std::move(job));
+			m_group.AddElement<FilledItem>(m_symbol, std::vector<FilledItemContour>(), color, matrix);
+			AddPendingItem(code.digest(), [result](GraphicItem& item) {
+				((FilledItem&)item).contours = result->get();
+			});
 		}
 
 		void SCShapeWriter::AddRasterizedRegion(
@@ -121,30 +368,181 @@ namespace sc {
 			float resolution
 		)
 		{
-			wk::RawImageRef sprite;
-			wk::Point offset;
-			DrawRegion(region, resolution, sprite, offset);
+			AddRasterizedRegions({ &region }, matrix, resolution);
+		}
 
-			const Animate::DOM::Utils::MATRIX2D transform = {
+		void SCShapeWriter::AddRasterizedRegions(
+			const std::vector<const FilledElementRegion*>& regions,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			float resolution
+		)
+		{
+			// Regions are drawn without matrix, so its scale is put into resolution to keep pixel density of placement
+			float placement_scale = std::min(SCWriter::GetMatrixScale(matrix), SCWriter::MaxPlacementResolution);
+			resolution = SCWriter::GetRasterizationResolution(resolution * placement_scale);
+
+			// Regions are read here, so workers get plain data and never touch or release DOM objects
+			wk::Ref<RasterizedSource> source = wk::CreateRef<RasterizedSource>();
+			source->matrix = matrix;
+			source->resolution = resolution;
+			source->regions.reserve(regions.size());
+
+			for (const FilledElementRegion* region : regions)
+			{
+				source->regions.push_back(LoadRasterRegion(*region));
+			}
+
+			source->key = SCShapeWriter::GetRasterizationKey(source->regions, SCShapeWriter::GetRegionsBound(source->regions));
+
+			uint64_t source_key = source->key;
+
+			Animate::DOM::Utils::MATRIX2D transform;
+			std::shared_future<HashedImage> sprite = SCShapeWriter::RasterizeAsync(m_writer, source, resolution, transform);
+
+			// Source is always kept, placements of the same artwork with bigger scale may need it to be drawn again
+			m_group.AddElement<BitmapItem>(m_symbol, HashedImage(), transform, source);
+
+			// Drawing is the same for every placement with the same key, transform is hashed with item itself
+			wk::hash::XxHash code;
+			code.update(source_key);
+			code.update(resolution);
+
+			// Sprite is awaited only by writer finalize, so the same job can be shared by many elements of many shapes
+			AddPendingItem(code.digest(), [sprite, transform, resolution](GraphicItem& item) {
+				((BitmapItem&)item).Replace(sprite.get(), transform, resolution);
+			});
+		}
+
+		std::shared_future<HashedImage> SCShapeWriter::RasterizeAsync(
+			SCWriter& writer,
+			const wk::Ref<RasterizedSource>& source,
+			float resolution,
+			Animate::DOM::Utils::MATRIX2D& transform
+		)
+		{
+			// Sprite position is known before drawing, so sprite itself can be taken from cache
+			Animate::DOM::Utils::RECT bound = SCShapeWriter::GetRegionsBound(source->regions);
+			wk::Point offset(bound.bottomRight.x, bound.bottomRight.y);
+
+			const Animate::DOM::Utils::MATRIX2D& matrix = source->matrix;
+			transform = {
 				matrix.a * (1.f / resolution),
-				matrix.b,
-				matrix.c,
+				matrix.b * (1.f / resolution),
+				matrix.c * (1.f / resolution),
 				matrix.d * (1.f / resolution),
 				std::round(offset.x * matrix.a + offset.y * matrix.c + matrix.tx),
 				std::round(offset.y * matrix.d + offset.x * matrix.b + matrix.ty)
 			};
 
-			m_group.AddElement<BitmapItem>(m_symbol, sprite, transform, true);
+			// Regions are drawn without matrix, so every placement of the same artwork shares one sprite
+			wk::hash::XxHash code;
+			code.update(source->key);
+			code.update(resolution);
+			uint64_t key = code.digest();
+
+			SCWriter::RasterizedSprite entry;
+			entry.region_count = source->regions.size();
+			entry.resolution = resolution;
+
+			Animate::DOM::Utils::RECT canvas_bound = bound;
+			SCShapeWriter::RoundDomRectangle(canvas_bound);
+			entry.width = canvas_bound.topLeft.x - canvas_bound.bottomRight.x;
+			entry.height = canvas_bound.topLeft.y - canvas_bound.bottomRight.y;
+
+			// Sprite is taken only if the entry was made for the same kind of input, other one is drawn without cache
+			bool collision = false;
+			auto cached = writer.rasterization_cache.find(key);
+			if (cached != writer.rasterization_cache.end())
+			{
+				const SCWriter::RasterizedSprite& other = cached->second;
+				if (other.region_count == entry.region_count && other.resolution == entry.resolution &&
+					other.width == entry.width && other.height == entry.height)
+				{
+					writer.rasterization_cache_hits++;
+					return other.sprite;
+				}
+
+				collision = true;
+				writer.rasterization_cache_collisions++;
+			}
+			else
+			{
+				writer.rasterization_cache_misses++;
+			}
+
+			JobPool* jobs = &writer.jobs;
+			std::shared_future<HashedImage> sprite = writer.jobs.Submit([source, resolution, jobs]() {
+				wk::RawImageRef result;
+				wk::Point result_offset;
+				DrawRegions(source->regions, resolution, result, result_offset, jobs->ThreadBudget());
+
+				// Hash is computed by worker too, once for all elements that share sprite
+				return HashedImage(result);
+			}).share();
+
+			if (!collision)
+			{
+				entry.sprite = sprite;
+				writer.rasterization_cache[key] = entry;
+			}
+
+			return sprite;
 		}
 
 		void SCShapeWriter::CreatePath(
-			const Animate::Publisher::FilledElementPath& path,
+			const RasterPath& path,
 			wk::PointF offset,
 			BLPath& contour,
 			float resolution
 		)
 		{
-			uint8_t inited = false;
+			auto point = [&path, &offset](size_t index) {
+				const Point2D& result = path.points[index];
+				return BLPoint(result.x + offset.x, result.y + offset.y);
+			};
+
+			size_t index = 0;
+			for (RasterPath::Verb verb : path.verbs)
+			{
+				switch (verb)
+				{
+				case RasterPath::Verb::Move:
+					contour.moveTo(point(index));
+					index += 1;
+					break;
+				case RasterPath::Verb::Line:
+					contour.lineTo(point(index));
+					index += 1;
+					break;
+				case RasterPath::Verb::Quad:
+					contour.quadTo(point(index), point(index + 1));
+					index += 2;
+					break;
+				case RasterPath::Verb::Cubic:
+					contour.cubicTo(point(index), point(index + 1), point(index + 2));
+					index += 3;
+					break;
+				default:
+					break;
+				}
+			}
+
+			if (resolution != 1.0f)
+			{
+				BLMatrix2D matrix(
+					resolution, 0, 0, resolution,
+					0, 0
+				);
+				contour.transform(matrix);
+			}
+		}
+
+		void SCShapeWriter::LoadRasterPath(const FilledElementPath& path, RasterPath& result)
+		{
+			auto add_point = [&result](const auto& point) {
+				result.points.push_back({ point.x, point.y });
+			};
+
 			for (size_t i = 0; path.Count() > i; i++)
 			{
 				const FilledElementPathSegment& segment = path.GetSegment(i);
@@ -154,101 +552,500 @@ namespace sc {
 				case FilledElementPathSegment::Type::Line:
 				{
 					const auto& seg = (const FilledElementPathLineSegment&)segment;
-
-					if (!inited++)
+					if (result.verbs.empty())
 					{
-						contour.moveTo(
-							seg.begin.x + offset.x,
-							seg.begin.y + offset.y
-						);
+						result.verbs.push_back(RasterPath::Verb::Move);
+						add_point(seg.begin);
 					}
 
-					contour.lineTo(
-						seg.end.x + offset.x,
-						seg.end.y + offset.y
-					);
+					result.verbs.push_back(RasterPath::Verb::Line);
+					add_point(seg.end);
 				}
-
 				break;
 				case FilledElementPathSegment::Type::Cubic:
 				{
 					const auto& seg = (const FilledElementPathCubicSegment&)segment;
-
-					if (!inited++)
+					if (result.verbs.empty())
 					{
-						contour.moveTo(
-							seg.begin.x + offset.x,
-							seg.begin.y + offset.y
-						);
+						result.verbs.push_back(RasterPath::Verb::Move);
+						add_point(seg.begin);
 					}
 
-					contour.cubicTo(
-						seg.control_l.x + offset.x, seg.control_l.y + offset.y,
-						seg.control_r.x + offset.x, seg.control_r.y + offset.y,
-						seg.end.x + offset.x, seg.end.y + offset.y
-					);
+					result.verbs.push_back(RasterPath::Verb::Cubic);
+					add_point(seg.control_l);
+					add_point(seg.control_r);
+					add_point(seg.end);
 				}
 				break;
 				case FilledElementPathSegment::Type::Quad:
 				{
 					const auto& seg = (const FilledElementPathQuadSegment&)segment;
-
-					if (!inited++)
+					if (result.verbs.empty())
 					{
-						contour.moveTo(
-							seg.begin.x + offset.x,
-							seg.begin.y + offset.y
-						);
+						result.verbs.push_back(RasterPath::Verb::Move);
+						add_point(seg.begin);
 					}
 
-					contour.quadTo(
-						seg.control.x + offset.x, seg.control.y + offset.y,
-						seg.end.x + offset.x, seg.end.y + offset.y
-					);
+					result.verbs.push_back(RasterPath::Verb::Quad);
+					add_point(seg.control);
+					add_point(seg.end);
 				}
 				break;
 				default:
 					break;
 				}
 			}
+		}
 
-			
-			if (resolution != 1.0f)
+		RasterRegion SCShapeWriter::LoadRasterRegion(const FilledElementRegion& region)
+		{
+			RasterRegion result;
+			result.type = region.type;
+			result.bound = region.Bound();
+
+			SCShapeWriter::LoadRasterPath(region.contour, result.contour);
+			result.holes.resize(region.holes.size());
+			for (size_t i = 0; region.holes.size() > i; i++)
 			{
-				BLMatrix2D matrix(
-					resolution, 0, 0, resolution,
-					0, 0
-				);
-				contour.transform(matrix);
+				SCShapeWriter::LoadRasterPath(region.holes[i], result.holes[i]);
+			}
+
+			if (region.type == FilledElementRegion::ShapeType::SolidColor)
+			{
+				result.color = std::get<FilledElementRegion::SolidFill>(region.style).color;
+			}
+			else if (region.type == FilledElementRegion::ShapeType::Bitmap)
+			{
+				const auto& fill = std::get<FilledElementRegion::BitmapFill>(region.style);
+
+				// Texture is premultiplied once per library bitmap, drawing shares it between sprites and must not change it
+				HashedImage texture = m_writer.GetFillTexture(fill.bitmap);
+				result.bitmap = texture.image;
+				result.bitmap_hash = texture.hash;
+				result.bitmap_matrix = fill.bitmap.Transformation();
+				result.bitmap_matrix.a /= Animate::DOM::TWIPS_PER_PIXEL;
+				result.bitmap_matrix.b /= Animate::DOM::TWIPS_PER_PIXEL;
+				result.bitmap_matrix.c /= Animate::DOM::TWIPS_PER_PIXEL;
+				result.bitmap_matrix.d /= Animate::DOM::TWIPS_PER_PIXEL;
+			}
+
+			return result;
+		}
+
+		Animate::DOM::Utils::RECT SCShapeWriter::GetRegionsBound(const std::vector<RasterRegion>& regions)
+		{
+			Animate::DOM::Utils::RECT bound = regions.front().bound;
+			for (size_t i = 1; regions.size() > i; i++)
+			{
+				bound = bound + regions[i].bound;
+			}
+
+			return bound;
+		}
+
+		// Coordinates are quantized so float error of translation does not break the key
+		static int32_t QuantizeCoordinate(float value, float origin)
+		{
+			return (int32_t)std::lround((value - origin) * 256.f);
+		}
+
+		static void HashPath(wk::hash::XxHash& code, const RasterPath& path, wk::PointF origin)
+		{
+			code.update(path.verbs.size());
+			for (RasterPath::Verb verb : path.verbs)
+			{
+				code.update((uint8_t)verb);
+			}
+
+			for (const Point2D& point : path.points)
+			{
+				code.update(QuantizeCoordinate(point.x, origin.x));
+				code.update(QuantizeCoordinate(point.y, origin.y));
+			}
+		}
+
+		// Hashes everything of region that affects its pixels, geometry is taken relative to origin
+		static void HashRegion(wk::hash::XxHash& code, const RasterRegion& region, wk::PointF origin)
+		{
+			code.update((uint8_t)region.type);
+
+			if (region.type == FilledElementRegion::ShapeType::SolidColor)
+			{
+				code.update(region.color.red);
+				code.update(region.color.green);
+				code.update(region.color.blue);
+				code.update(region.color.alpha);
+			}
+			else if (region.type == FilledElementRegion::ShapeType::Bitmap)
+			{
+				// Pattern is not moved with region so its full matrix matters
+				const Animate::DOM::Utils::MATRIX2D& pattern = region.bitmap_matrix;
+				code.update(pattern.a);
+				code.update(pattern.b);
+				code.update(pattern.c);
+				code.update(pattern.d);
+				code.update(pattern.tx);
+				code.update(pattern.ty);
+
+				// Pixels were hashed once when bitmap was loaded
+				code.update(region.bitmap_hash);
+			}
+
+			HashPath(code, region.contour, origin);
+
+			code.update(region.holes.size());
+			for (const RasterPath& hole : region.holes)
+			{
+				HashPath(code, hole, origin);
+			}
+		}
+
+		uint64_t SCShapeWriter::GetRasterizationKey(
+			const std::vector<RasterRegion>& regions,
+			const Animate::DOM::Utils::RECT& bound
+		)
+		{
+			wk::hash::XxHash code;
+
+			wk::PointF origin(
+				std::min(bound.topLeft.x, bound.bottomRight.x),
+				std::min(bound.topLeft.y, bound.bottomRight.y)
+			);
+
+			// Canvas size depends on fractional part of bound
+			Animate::DOM::Utils::RECT canvas_bound = bound;
+			SCShapeWriter::RoundDomRectangle(canvas_bound);
+			code.update(canvas_bound.topLeft.x - canvas_bound.bottomRight.x);
+			code.update(canvas_bound.topLeft.y - canvas_bound.bottomRight.y);
+
+			for (const RasterRegion& region : regions)
+			{
+				HashRegion(code, region, origin);
+			}
+
+			return code.digest();
+		}
+
+		uint64_t SCShapeWriter::GetSliceKey(const SlicedSource& source)
+		{
+			wk::hash::XxHash code;
+
+			// Guides and regions are in symbol space, so they are hashed as they are
+			const Animate::DOM::Utils::RECT& guides = source.guides;
+			code.update(guides.topLeft.x);
+			code.update(guides.topLeft.y);
+			code.update(guides.bottomRight.x);
+			code.update(guides.bottomRight.y);
+
+			// Strokes are not drawn but still make sprite bigger
+			const Animate::DOM::Utils::RECT& bound = source.bound;
+			code.update(bound.topLeft.x);
+			code.update(bound.topLeft.y);
+			code.update(bound.bottomRight.x);
+			code.update(bound.bottomRight.y);
+
+			for (const RasterRegion& region : source.regions)
+			{
+				HashRegion(code, region, wk::PointF(0.f, 0.f));
+			}
+
+			return code.digest();
+		}
+
+		// Positive for counter clockwise turn at b
+		static float Cross(const CDT::V2d<float>& a, const CDT::V2d<float>& b, const CDT::V2d<float>& c)
+		{
+			return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+		}
+
+		static bool IsConvexPolygon(const std::pmr::vector<CDT::V2d<float>>& vertices, const std::vector<uint32_t>& polygon)
+		{
+			for (size_t i = 0; polygon.size() > i; i++)
+			{
+				const auto& a = vertices[polygon[i]];
+				const auto& b = vertices[polygon[(i + 1) % polygon.size()]];
+				const auto& c = vertices[polygon[(i + 2) % polygon.size()]];
+
+				if (0.f > Cross(a, b, c)) return false;
+			}
+
+			return true;
+		}
+
+		// Segments cross or touch each other
+		static bool IsSegmentsIntersect(
+			const CDT::V2d<float>& a, const CDT::V2d<float>& b,
+			const CDT::V2d<float>& c, const CDT::V2d<float>& d
+		)
+		{
+			float abc = Cross(a, b, c);
+			float abd = Cross(a, b, d);
+			float cda = Cross(c, d, a);
+			float cdb = Cross(c, d, b);
+
+			if (((abc > 0.f && abd < 0.f) || (abc < 0.f && abd > 0.f)) &&
+				((cda > 0.f && cdb < 0.f) || (cda < 0.f && cdb > 0.f)))
+			{
+				return true;
 			}
+
+			// Collinear point lies on other segment
+			auto on_segment = [](const CDT::V2d<float>& p, const CDT::V2d<float>& q, const CDT::V2d<float>& r)
+			{
+				return std::min(p.x, q.x) <= r.x && r.x <= std::max(p.x, q.x) &&
+					std::min(p.y, q.y) <= r.y && r.y <= std::max(p.y, q.y);
+			};
+
+			return (abc == 0.f && on_segment(a, b, c)) ||
+				(abd == 0.f && on_segment(a, b, d)) ||
+				(cda == 0.f && on_segment(c, d, a)) ||
+				(cdb == 0.f && on_segment(c, d, b));
 		}
 
-		bool SCShapeWriter::IsComplexShapeRegion(const FilledElementRegion& region)
+		bool SCShapeWriter::ClipEars(const std::pmr::vector<CDT::V2d<float>>& vertices, std::vector<TriangulationCache::Triangle>& triangles)
 		{
-			for (size_t i = 0; region.contour.Count() > i; i++)
+			const size_t count = vertices.size();
+			if (3 > count) return false;
+
+			float area = 0.f;
+			for (size_t i = 0; count > i; i++)
 			{
-				const FilledElementPathSegment& segment = region.contour.GetSegment(i);
+				const auto& a = vertices[i];
+				const auto& b = vertices[(i + 1) % count];
+				area += a.x * b.y - b.x * a.y;
+			}
+
+			if (area == 0.f) return false;
 
-				if (segment.SegmentType() != FilledElementPathSegment::Type::Line)
+			// Only simple contours are clipped, crossing ones are left for Delaunay triangulation
+			for (size_t i = 0; count > i; i++)
+			{
+				for (size_t j = i + 2; count > j; j++)
 				{
-					return true;
+					// Neighbor edges share a vertex
+					if (i == 0 && j == count - 1) continue;
+
+					if (IsSegmentsIntersect(vertices[i], vertices[i + 1], vertices[j], vertices[(j + 1) % count]))
+					{
+						return false;
+					}
 				}
 			}
 
-			for (const FilledElementPath& path : region.holes)
+			// Counter clockwise order, so ears are convex corners
+			std::vector<uint32_t> polygon(count);
+			std::iota(polygon.begin(), polygon.end(), 0);
+			if (0.f > area)
+			{
+				std::reverse(polygon.begin(), polygon.end());
+			}
+
+			triangles.reserve(count - 2);
+
+			size_t index = 0;
+			size_t attempts = 0;
+			while (polygon.size() > 3)
+			{
+				// Whole contour was walked without any ear
+				if (attempts >= polygon.size()) return false;
+
+				size_t size = polygon.size();
+				uint32_t prev = polygon[(index + size - 1) % size];
+				uint32_t current = polygon[index % size];
+				uint32_t next = polygon[(index + 1) % size];
+
+				const auto& a = vertices[prev];
+				const auto& b = vertices[current];
+				const auto& c = vertices[next];
+
+				float turn = Cross(a, b, c);
+
+				// Collinear corner has no area, so it is removed without triangle
+				bool ear = turn == 0.f;
+
+				if (turn > 0.f)
+				{
+					ear = true;
+					for (uint32_t other : polygon)
+					{
+						if (other == prev || other == current || other == next) continue;
+
+						const auto& p = vertices[other];
+						if (Cross(a, b, p) >= 0.f && Cross(b, c, p) >= 0.f && Cross(c, a, p) >= 0.f)
+						{
+							ear = false;
+							break;
+						}
+					}
+
+					if (ear)
+					{
+						triangles.push_back({ prev, current, next });
+					}
+				}
+
+				if (ear)
+				{
+					polygon.erase(polygon.begin() + (index % size));
+					attempts = 0;
+				}
+				else
+				{
+					index++;
+					attempts++;
+				}
+
+				index %= polygon.size();
+			}
+
+			if (Cross(vertices[polygon[0]], vertices[polygon[1]], vertices[polygon[2]]) > 0.f)
+			{
+				triangles.push_back({ polygon[0], polygon[1], polygon[2] });
+			}
+
+			return !triangles.empty();
+		}
+
+		void SCShapeWriter::MergeTriangles(
+			const std::pmr::vector<CDT::V2d<float>>& vertices,
+			const std::vector<TriangulationCache::Triangle>& triangles,
+			std::pmr::vector<std::pmr::vector<uint32_t>>& result
+		)
+		{
+			std::pmr::memory_resource* memory = result.get_allocator().resource();
+
+			// Polygon of each triangle in counter clockwise order, merged ones are left empty
+			std::pmr::vector<std::pmr::vector<uint32_t>> polygons(memory);
+			polygons.reserve(triangles.size());
+
+			for (const TriangulationCache::Triangle& triangle : triangles)
+			{
+				std::pmr::vector<uint32_t>& polygon = polygons.emplace_back(triangle.begin(), triangle.end());
+				if (0.f > Cross(vertices[polygon[0]], vertices[polygon[1]], vertices[polygon[2]]))
+				{
+					std::swap(polygon[1], polygon[2]);
+				}
+			}
+
+			// Owner polygon of every triangle
+			std::pmr::vector<size_t> owners(triangles.size(), memory);
+			std::iota(owners.begin(), owners.end(), 0);
+
+			auto find_owner = [&owners](size_t index) {
+				while (owners[index] != index)
+				{
+					owners[index] = owners[owners[index]];
+					index = owners[index];
+				}
+
+				return index;
+			};
+
+			// Edge / triangles that share it
+			std::pmr::map<std::pair<uint32_t, uint32_t>, std::pmr::vector<size_t>> edges(memory);
+			for (size_t i = 0; triangles.size() > i; i++)
 			{
-				for (size_t i = 0; path.Count() > i; i++)
+				for (size_t v = 0; 3 > v; v++)
 				{
-					const FilledElementPathSegment& segment = path.GetSegment(i);
+					uint32_t first = triangles[i][v];
+					uint32_t second = triangles[i][(v + 1) % 3];
+					edges[{ std::min(first, second), std::max(first, second) }].push_back(i);
+				}
+			}
+
+			// Hertel-Mehlhorn: remove diagonals while polygons stay convex
+			for (const auto& [edge, owner_triangles] : edges)
+			{
+				if (owner_triangles.size() != 2) continue;
 
-					if (segment.SegmentType() != FilledElementPathSegment::Type::Line)
+				size_t first_index = find_owner(owner_triangles[0]);
+				size_t second_index = find_owner(owner_triangles[1]);
+				if (first_index == second_index) continue;
+
+				std::pmr::vector<uint32_t>& first = polygons[first_index];
+				std::pmr::vector<uint32_t>& second = polygons[second_index];
+
+				if (first.size() + second.size() - 2 > SCShapeWriter::MaxPolygonVertices) continue;
+
+				// First polygon goes a -> b, so the second one goes b -> a
+				size_t first_position = SIZE_MAX;
+				for (size_t i = 0; first.size() > i; i++)
+				{
+					uint32_t a = first[i];
+					uint32_t b = first[(i + 1) % first.size()];
+					if ((a == edge.first && b == edge.second) || (a == edge.second && b == edge.first))
 					{
-						return true;
+						first_position = i;
+						break;
 					}
 				}
+
+				if (first_position == SIZE_MAX) continue;
+
+				uint32_t a = first[first_position];
+				uint32_t b = first[(first_position + 1) % first.size()];
+
+				auto second_it = std::find(second.begin(), second.end(), b);
+				if (second_it == second.end()) continue;
+				size_t second_position = std::distance(second.begin(), second_it);
+				if (second[(second_position + 1) % second.size()] != a) continue;
+
+				// b ... a from first polygon and then everything between a and b from second one
+				std::pmr::vector<uint32_t> merged(memory);
+				merged.reserve(first.size() + second.size() - 2);
+				for (size_t i = 0; first.size() > i; i++)
+				{
+					merged.push_back(first[(first_position + 1 + i) % first.size()]);
+				}
+
+				for (size_t i = 2; second.size() > i; i++)
+				{
+					merged.push_back(second[(second_position + i) % second.size()]);
+				}
+
+				if (!IsConvexPolygon(vertices, merged)) continue;
+
+				first = std::move(merged);
+				second.clear();
+				owners[second_index] = first_index;
 			}
 
-			return false;
+			result.clear();
+			for (std::pmr::vector<uint32_t>& polygon : polygons)
+			{
+				if (polygon.empty()) continue;
+
+				result.push_back(std::move(polygon));
+			}
+		}
+
+		uint64_t SCShapeWriter::GetTriangulationKey(const std::pmr::vector<CDT::V2d<float>>& vertices, const std::pmr::vector<CDT::Edge>& edges)
+		{
+			wk::hash::XxHash code;
+
+			// Triangulation does not depend on position, so the same contours in other place share one result
+			wk::PointF origin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+			for (const CDT::V2d<float>& vertex : vertices)
+			{
+				origin.x = std::min(origin.x, vertex.x);
+				origin.y = std::min(origin.y, vertex.y);
+			}
+
+			code.update(vertices.size());
+			for (const CDT::V2d<float>& vertex : vertices)
+			{
+				code.update(QuantizeCoordinate(vertex.x, origin.x));
+				code.update(QuantizeCoordinate(vertex.y, origin.y));
+			}
+
+			code.update(edges.size());
+			for (const CDT::Edge& edge : edges)
+			{
+				code.update(edge.v1());
+				code.update(edge.v2());
+			}
+
+			return code.digest();
 		}
 
 		bool SCShapeWriter::IsValidFilledShapeRegion(const FilledElementRegion& region)
@@ -276,130 +1073,533 @@ namespace sc {
 
 		void SCShapeWriter::AddFilledShapeRegion(
 			const FilledElementRegion& region,
-			const Animate::DOM::Utils::MATRIX2D& matrix
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			bool is_stroke
 		) {
+			const SCConfig& config = SCPlugin::Publisher::ActiveConfig();
+
+			// Gradient fills come without style data, so they can be neither drawn nor turned into ramps.
+			// They are still dropped, only their count is reported at finalize.
+			if (region.type != FilledElementRegion::ShapeType::SolidColor &&
+				region.type != FilledElementRegion::ShapeType::Bitmap)
+			{
+				m_writer.unsupported_fill_regions++;
+				return;
+			}
+
 			if (!IsValidFilledShapeRegion(region)) return;
 
+			// Solid regions are walked only once, every consumer below takes points from this geometry
+			RegionGeometry geometry;
+			if (region.type == FilledElementRegion::ShapeType::SolidColor)
+			{
+				SCShapeWriter::AnalyseRegion(region, matrix, geometry);
+			}
+
 			bool should_rasterize =
 				region.type != FilledElementRegion::ShapeType::SolidColor ||
-				IsComplexShapeRegion(region);
+				geometry.curved;
+
+			bool is_contour =
+				!should_rasterize &&
+				region.contour.Count() <= 4 &&
+				region.holes.empty();
+
+			// Small contours with holes are triangulated too, so no straight region is dropped
+			bool should_triangulate =
+				!should_rasterize &&
+				!is_contour;
+
+			// Curved solid fills can be turned into triangles if they are not too complex
+			// Strokes come as outlines with joins and caps already built, so they are tessellated the same way
+			if (should_rasterize &&
+				region.type == FilledElementRegion::ShapeType::SolidColor)
+			{
+				const auto& fill = std::get<FilledElementRegion::SolidFill>(region.style);
+
+				// Each kind of region has its own toggle
+				if (is_stroke)
+				{
+					if (config.tessellateStrokes &&
+						AddTessellatedRegion(geometry, matrix, fill.color, SCShapeWriter::StrokeTessellationTriangleBudget)) return;
+				}
+				else if (config.tessellateCurves)
+				{
+					if (AddTessellatedRegion(geometry, matrix, fill.color)) return;
+				}
+			}
+
+			if (should_rasterize)
+			{
+				// Rasterization is postponed so neighbor regions can share one sprite
+				if (!m_vector_graphics.empty() && !IsSameMatrix(m_vector_matrix, matrix))
+				{
+					ReleaseVectorGraphic();
+				}
+
+				m_vector_matrix = matrix;
+				m_vector_graphics.push_back(region);
+				return;
+			}
+			ReleaseVectorGraphic();
+
+			// Any non-solid color fill will be rasterized, so at this moment we have guarantee that fill style is Solid Color
+			const auto& fill = std::get<FilledElementRegion::SolidFill>(region.style);
+
+			// Region waits for the rest of element fills to be merged with abutting ones
+			if (m_coalesce_regions)
+			{
+				StraightRegion& straight = m_straight_regions.emplace_back();
+				straight.geometry = std::move(geometry);
+				straight.color = fill.color;
+				straight.is_contour = is_contour;
+				m_straight_matrix = matrix;
+				return;
+			}
+
+			if (is_contour)
+			{
+				std::vector<FilledItemContour> contour = { FilledItemContour(geometry.contour, m_writer.ContourMemory()) };
+				Animate::DOM::Utils::COLOR color = fill.color;
+				m_group.AddElement<FilledItem>(m_symbol, contour, color, matrix);
+			}
+			else if (should_triangulate)
+			{
+				AddTriangulatedRegion(geometry.contour, geometry.holes, matrix, fill.color);
+			}
+		}
+
+		void SCShapeWriter::ReleaseStraightRegions()
+		{
+			if (m_straight_regions.empty()) return;
+
+			// Regions are joined when they share at least one edge and have the same color
+			std::vector<size_t> parents(m_straight_regions.size());
+			std::iota(parents.begin(), parents.end(), 0);
+
+			auto find_root = [&parents](size_t index)
+			{
+				while (parents[index] != index)
+				{
+					parents[index] = parents[parents[index]];
+					index = parents[index];
+				}
+
+				return index;
+			};
+
+			// Edge key does not depend on direction, abutting regions walk their shared edge in opposite ways
+			auto edge_key = [](const Point2D& first, const Point2D& second)
+			{
+				bool ordered = first.x < second.x || (first.x == second.x && first.y < second.y);
+				const Point2D& from = ordered ? first : second;
+				const Point2D& to = ordered ? second : first;
+
+				wk::hash::XxHash code;
+				code.update(from.x);
+				code.update(from.y);
+				code.update(to.x);
+				code.update(to.y);
+				return code.digest();
+			};
+
+			std::unordered_map<uint64_t, size_t> edges;
+			for (size_t i = 0; m_straight_regions.size() > i; i++)
+			{
+				const StraightRegion& region = m_straight_regions[i];
+
+				auto add_path = [&](const std::vector<Point2D>& points)
+				{
+					for (size_t p = 0; points.size() > p; p++)
+					{
+						uint64_t key = edge_key(points[p], points[(p + 1) % points.size()]);
+
+						auto [it, inserted] = edges.emplace(key, i);
+						if (inserted || !IsSameColor(m_straight_regions[it->second].color, region.color)) continue;
+
+						parents[find_root(it->second)] = find_root(i);
+					}
+				};
+
+				add_path(region.geometry.contour);
+				for (const std::vector<Point2D>& hole : region.geometry.holes)
+				{
+					add_path(hole);
+				}
+			}
+
+			// Groups keep order of their first regions
+			std::vector<std::vector<size_t>> groups;
+			std::unordered_map<size_t, size_t> group_indices;
+			for (size_t i = 0; m_straight_regions.size() > i; i++)
+			{
+				auto [it, inserted] = group_indices.emplace(find_root(i), groups.size());
+				if (inserted) groups.emplace_back();
+
+				groups[it->second].push_back(i);
+			}
+
+			for (const std::vector<size_t>& group : groups)
+			{
+				const StraightRegion& first = m_straight_regions[group.front()];
+
+				if (group.size() > 1)
+				{
+					std::vector<const RegionGeometry*> geometries;
+					geometries.reserve(group.size());
+					for (size_t index : group)
+					{
+						geometries.push_back(&m_straight_regions[index].geometry);
+					}
+
+					AddCoalescedRegions(geometries, m_straight_matrix, first.color);
+
+					m_writer.coalesced_regions += group.size();
+					m_writer.coalesced_polygons++;
+				}
+				else if (first.is_contour)
+				{
+					std::vector<FilledItemContour> contour = { FilledItemContour(first.geometry.contour, m_writer.ContourMemory()) };
+					Animate::DOM::Utils::COLOR color = first.color;
+					Animate::DOM::Utils::MATRIX2D matrix = m_straight_matrix;
+					m_group.AddElement<FilledItem>(m_symbol, contour, color, matrix);
+				}
+				else
+				{
+					AddTriangulatedRegion(first.geometry.contour, first.geometry.holes, m_straight_matrix, first.color);
+				}
+			}
+
+			m_straight_regions.clear();
+		}
+
+		void SCShapeWriter::RemoveSharedEdges(std::pmr::vector<CDT::V2d<float>>& vertices, std::pmr::vector<CDT::Edge>& edges)
+		{
+			// Edge that is walked by two regions lies inside of their union
+			std::pmr::memory_resource* memory = edges.get_allocator().resource();
+
+			std::pmr::unordered_map<uint64_t, size_t> counts(memory);
+			for (const CDT::Edge& edge : edges)
+			{
+				counts[((uint64_t)edge.v1() << 32) | edge.v2()]++;
+			}
+
+			std::pmr::vector<CDT::Edge> outline(memory);
+			outline.reserve(edges.size());
+			for (auto& [key, count] : counts)
+			{
+				if (count % 2 == 0) continue;
+
+				outline.push_back(CDT::Edge((uint32_t)(key >> 32), (uint32_t)key));
+			}
+
+			// Sorted so triangulation key does not depend on hash map order
+			std::sort(outline.begin(), outline.end(), [](const CDT::Edge& first, const CDT::Edge& second) {
+				return first.v1() < second.v1() || (first.v1() == second.v1() && first.v2() < second.v2());
+			});
+
+			// Vertices of removed edges would only add triangles inside of union
+			constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+			std::pmr::vector<uint32_t> remap(vertices.size(), unused, memory);
+			std::pmr::vector<CDT::V2d<float>> used_vertices(vertices.get_allocator());
+			used_vertices.reserve(vertices.size());
+
+			for (CDT::Edge& edge : outline)
+			{
+				uint32_t indices[2] = { (uint32_t)edge.v1(), (uint32_t)edge.v2() };
+				for (uint32_t& index : indices)
+				{
+					if (remap[index] == unused)
+					{
+						remap[index] = (uint32_t)used_vertices.size();
+						used_vertices.push_back(vertices[index]);
+					}
+
+					index = remap[index];
+				}
+
+				edge = CDT::Edge(indices[0], indices[1]);
+			}
+
+			vertices = std::move(used_vertices);
+			edges = std::move(outline);
+		}
+
+		void SCShapeWriter::AnalyseRegion(
+			const FilledElementRegion& region,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			RegionGeometry& geometry
+		)
+		{
+			// Tolerance is given in screen pixels, so scaled up shapes get more segments
+			float scale_x = std::sqrt(matrix.a * matrix.a + matrix.b * matrix.b);
+			float scale_y = std::sqrt(matrix.c * matrix.c + matrix.d * matrix.d);
+			float scale = std::max({ scale_x, scale_y, std::numeric_limits<float>::epsilon() });
+			float tolerance = SCShapeWriter::TessellationTolerance / scale;
+
+			geometry.curved = false;
+			geometry.contour.clear();
+			geometry.holes.clear();
+
+			SCShapeWriter::FlattenPath(region.contour, tolerance, geometry.contour, geometry.curved);
+
+			geometry.holes.reserve(region.holes.size());
+			for (const FilledElementPath& hole : region.holes)
+			{
+				SCShapeWriter::FlattenPath(hole, tolerance, geometry.holes.emplace_back(), geometry.curved);
+			}
+		}
+
+		bool SCShapeWriter::AddTessellatedRegion(
+			const RegionGeometry& geometry,
+			const Animate::DOM::Utils::MATRIX2D& matrix,
+			const Animate::DOM::Utils::COLOR& color,
+			size_t triangle_budget
+		)
+		{
+			if (3 > geometry.contour.size()) return false;
+
+			size_t vertex_count = geometry.contour.size();
+			for (const std::vector<Point2D>& hole : geometry.holes)
+			{
+				vertex_count += hole.size();
+			}
+
+			// Triangle count of polygon with holes is V + 2H - 2
+			size_t triangle_count = vertex_count + geometry.holes.size() * 2 - 2;
+			if (triangle_count > triangle_budget) return false;
+
+			ReleaseVectorGraphic();
+
+			AddTriangulatedRegion(geometry.contour, geometry.holes, matrix, color);
+
+			return true;
+		}
+
+		void SCShapeWriter::FlattenPath(const FilledElementPath& path, float tolerance, std::vector<Point2D>& points, bool& curved)
+		{
+			auto distance = [](float x, float y) {
+				return std::sqrt(x * x + y * y);
+			};
+
+			// Uniform subdivision with error of chords not bigger than tolerance
+			auto segment_count = [&tolerance](float deviation, float factor) {
+				float count = std::ceil(std::sqrt(deviation * factor / tolerance));
+				return (uint32_t)std::clamp(count, 1.f, 64.f);
+			};
+
+			for (size_t i = 0; path.Count() > i; i++)
+			{
+				const FilledElementPathSegment& segment = path.GetSegment(i);
+
+				switch (segment.SegmentType())
+				{
+				case FilledElementPathSegment::Type::Line:
+				{
+					const auto& seg = (const FilledElementPathLineSegment&)segment;
+					if (points.empty()) points.push_back({ seg.begin.x, seg.begin.y });
 
-			bool is_contour =
-				!should_rasterize &&
-				region.contour.Count() <= 4 && !(region.contour.Count() > 6) &&
-				region.holes.empty();
+					points.push_back({ seg.end.x, seg.end.y });
+				}
+				break;
+				case FilledElementPathSegment::Type::Quad:
+				{
+					const auto& seg = (const FilledElementPathQuadSegment&)segment;
+					if (points.empty()) points.push_back({ seg.begin.x, seg.begin.y });
+					curved = true;
 
-			bool should_triangulate =
-				!should_rasterize &&
-				region.contour.Count() > 4;
+					// Error of n chords is |p0 - 2p1 + p2| / (4n^2)
+					float deviation = distance(
+						seg.begin.x - 2 * seg.control.x + seg.end.x,
+						seg.begin.y - 2 * seg.control.y + seg.end.y
+					);
 
-			FilledElementRegion transformed_region = region;
+					uint32_t count = segment_count(deviation, 0.25f);
+					for (uint32_t step = 1; count >= step; step++)
+					{
+						float t = (float)step / count;
+						float u = 1.f - t;
 
-			if (should_rasterize)
-			{
-				RoundRegion(transformed_region);
-				AddRasterizedRegion(region, matrix);
-				return;
-			}
-			ReleaseVectorGraphic();
+						points.push_back({
+							u * u * seg.begin.x + 2 * u * t * seg.control.x + t * t * seg.end.x,
+							u * u * seg.begin.y + 2 * u * t * seg.control.y + t * t * seg.end.y
+						});
+					}
+				}
+				break;
+				case FilledElementPathSegment::Type::Cubic:
+				{
+					const auto& seg = (const FilledElementPathCubicSegment&)segment;
+					if (points.empty()) points.push_back({ seg.begin.x, seg.begin.y });
+					curved = true;
+
+					// Error of n chords is not bigger than 3 * max(|p0 - 2p1 + p2|, |p1 - 2p2 + p3|) / (4n^2)
+					float deviation = std::max(
+						distance(
+							seg.begin.x - 2 * seg.control_l.x + seg.control_r.x,
+							seg.begin.y - 2 * seg.control_l.y + seg.control_r.y
+						),
+						distance(
+							seg.control_l.x - 2 * seg.control_r.x + seg.end.x,
+							seg.control_l.y - 2 * seg.control_r.y + seg.end.y
+						)
+					);
 
-			// Any non-solid color fill will be rasterized, so at this moment we have guarantee that fill style is Solid Color
-			const auto& fill = std::get<FilledElementRegion::SolidFill>(region.style);
-			if (is_contour)
-			{
-				std::vector<Point2D> points;
-				region.contour.Rasterize(points);
+					uint32_t count = segment_count(deviation, 0.75f);
+					for (uint32_t step = 1; count >= step; step++)
+					{
+						float t = (float)step / count;
+						float u = 1.f - t;
 
-				std::vector<FilledItemContour> contour = { FilledItemContour(points) };
-				m_group.AddElement<FilledItem>(m_symbol, contour, fill.color, matrix);
+						points.push_back({
+							u * u * u * seg.begin.x + 3 * u * u * t * seg.control_l.x + 3 * u * t * t * seg.control_r.x + t * t * t * seg.end.x,
+							u * u * u * seg.begin.y + 3 * u * u * t * seg.control_l.y + 3 * u * t * t * seg.control_r.y + t * t * t * seg.end.y
+						});
+					}
+				}
+				break;
+				default:
+					break;
+				}
 			}
-			else if (should_triangulate)
+
+			// Contour is closed by triangulation itself
+			if (points.size() > 1 && points.front().x == points.back().x && points.front().y == points.back().y)
 			{
-				AddTriangulatedRegion(region.contour, region.holes, matrix, fill.color);
+				points.pop_back();
 			}
 		}
 
 		void SCShapeWriter::AddSlicedElements(const Animate::Publisher::Slice9Element& slice)
 		{
+			ReleaseVectorGraphic();
+
 			// 9Slice sprites are usually very pixelated
 			// So we need to scale their resolution by 2
 			// But xy coordinates must be remains the same
 
-			// So first we create a bigger guide
+			const SCConfig& config = SCPlugin::Publisher::ActiveConfig();
 
 			const float resolution = SCShapeWriter::RasterizationResolution;
-			auto guides = slice.Guides();
-			Animate::DOM::Utils::RECT element_guides =
-			{
-				{guides.topLeft.x * resolution, guides.topLeft.y * resolution},
-				{guides.bottomRight.x * resolution, guides.bottomRight.y * resolution}
-			};
 
-			Animate::DOM::Utils::RECT bound{
+			// Regions are read with element transformation applied, so they can be drawn later by workers without DOM
+			wk::Ref<SlicedSource> source = wk::CreateRef<SlicedSource>();
+			source->guides = slice.Guides();
+			source->resolution = resolution;
+			source->bound = {
 				{std::numeric_limits<float>::min(),
 				std::numeric_limits<float>::min()},
 				{std::numeric_limits<float>::max(),
 				std::numeric_limits<float>::max()}
 			};
 
-			// Then create copy of elements
-			// And make their points bigger
-			std::vector<FilledElement> transformed_elements;
 			const auto& elements = slice.Elements();
 			for (size_t i = 0; elements.Size() > i; i++)
 			{
 				StaticElement& element = elements[i];
 				if (!element.IsFilledArea()) continue;
 
-				FilledElement& transformed_element = transformed_elements.emplace_back((const FilledElement&)element);
+				FilledElement transformed_element((const FilledElement&)element);
 				transformed_element.Transform(
 					element.Transformation()
 				);
 
-				transformed_element.Transform(
-					{
-						resolution,
-						0.0f,
-						0.0f,
-						resolution,
-						0.0f,
-						0.0f
-					}
-				);
+				source->bound = source->bound + transformed_element.Bound();
 
-				bound = bound + transformed_element.Bound();
+				for (const FilledElementRegion& region : transformed_element.fill)
+				{
+					if (!IsValidFilledShapeRegion(region)) continue;
 
-				//for (auto& region : transformed_element.fill)
-				//{
-				//	SCShapeWriter::RoundRegion(region);
-				//}
-				//
-				//for (auto& region : transformed_element.stroke)
-				//{
-				//	SCShapeWriter::RoundRegion(region);
-				//}
+					source->regions.push_back(LoadRasterRegion(region));
+				}
 			}
 
-			wk::Point offset(bound.bottomRight.x, bound.bottomRight.y);
-			SCShapeWriter::RoundDomRectangle(bound);
-			wk::RawImageRef sprite = wk::CreateRef<wk::RawImage>(
-				std::ceil(bound.topLeft.x - offset.x),
-				std::ceil(bound.topLeft.y - offset.y),
-				wk::Image::PixelDepth::RGBA8
-			);
+			source->key = SCShapeWriter::GetSliceKey(*source);
+
+			HashedImage sprite;
+			wk::Point offset;
+			Animate::DOM::Utils::RECT element_guides;
+			Animate::DOM::Utils::MATRIX2D transform;
+			SCShapeWriter::RasterizeSlice(*source, resolution, sprite, offset, element_guides, transform, m_writer.jobs.ThreadBudget());
 
-			for (const FilledElement& element : transformed_elements)
+			// Source is needed only if sprite may be drawn again with another resolution
+			if (config.adaptiveRasterization == SCConfig::AdaptiveRasterization::Disabled)
 			{
-				for (const FilledElementRegion region : element.fill)
+				source.reset();
+			}
+
+			m_group.AddElement<SlicedItem>(m_symbol, sprite, transform, offset, element_guides, source);
+		}
+
+		void SCShapeWriter::RasterizeSlice(
+			const SlicedSource& source,
+			float resolution,
+			HashedImage& sprite,
+			wk::Point& offset,
+			Animate::DOM::Utils::RECT& element_guides,
+			Animate::DOM::Utils::MATRIX2D& transform,
+			size_t thread_count
+		)
+		{
+			// So first we create a bigger guide
+			const Animate::DOM::Utils::RECT& guides = source.guides;
+			element_guides =
+			{
+				{guides.topLeft.x * resolution, guides.topLeft.y * resolution},
+				{guides.bottomRight.x * resolution, guides.bottomRight.y * resolution}
+			};
+
+			Animate::DOM::Utils::RECT bound{
+				{source.bound.topLeft.x * resolution, source.bound.topLeft.y * resolution},
+				{source.bound.bottomRight.x * resolution, source.bound.bottomRight.y * resolution}
+			};
+
+			// Then create copy of regions
+			// And make their points bigger
+			std::vector<RasterRegion> regions = source.regions;
+			auto scale_path = [resolution](RasterPath& path) {
+				for (Point2D& point : path.points)
 				{
-					if (!IsValidFilledShapeRegion(region)) continue;
+					point.x *= resolution;
+					point.y *= resolution;
+				}
+			};
 
-					DrawRegionTo(sprite, region, offset);
+			for (RasterRegion& region : regions)
+			{
+				scale_path(region.contour);
+				for (RasterPath& hole : region.holes)
+				{
+					scale_path(hole);
 				}
 			}
 
+			offset = wk::Point(bound.bottomRight.x, bound.bottomRight.y);
+			SCShapeWriter::RoundDomRectangle(bound);
+			RasterizingContext canvas;
+			canvas.image = wk::CreateRef<wk::RawImage>(
+				std::max(std::ceil(bound.topLeft.x - offset.x), 1.f),
+				std::max(std::ceil(bound.topLeft.y - offset.y), 1.f),
+				wk::Image::PixelDepth::RGBA8
+			);
+			SCShapeWriter::CreateImage(canvas.image, canvas.canvas_image, false);
+
+			canvas.ctx = SCShapeWriter::CreateContext(canvas.canvas_image, thread_count);
+			canvas.ctx.clearAll();
+
+			// All regions are drawn right into sprite, so they are blended by canvas itself
+			const wk::PointF region_offset(-(float)offset.x, -(float)offset.y);
+
+			for (const RasterRegion& region : regions)
+			{
+				DrawRegion(canvas, region, region_offset);
+			}
+
+			ReleaseCanvas(canvas);
+			sprite = HashedImage(canvas.image);
+
 			// Scale back
-			const Animate::DOM::Utils::MATRIX2D transform = {
+			transform = {
 				1.f / resolution,
 				0.0f,
 				0.0f,
@@ -407,8 +1607,6 @@ namespace sc {
 				0,
 				0
 			};
-
-			m_group.AddElement<SlicedItem>(m_symbol, sprite, transform, offset, element_guides);
 		}
 
 		void SCShapeWriter::RoundDomRectangle(Animate::DOM::Utils::RECT& rect)
@@ -421,12 +1619,28 @@ namespace sc {
 
 		std::size_t SCShapeWriter::GenerateHash() const
 		{
+			// Hash depends on final group content so everything postponed must be done first
+			SCShapeWriter& writer = const_cast<SCShapeWriter&>(*this);
+			writer.ReleaseVectorGraphic();
+
 			wk::hash::XxHash code;
 
+			// Jobs are not awaited, content of their items is replaced with hash of job input
+			auto pending = m_pending_items.begin();
 			for (size_t i = 0; m_group.Size() > i; i++)
 			{
 				const GraphicItem& item = (const GraphicItem&)m_group[i];
-				code.update(item);
+
+				if (pending != m_pending_items.end() && pending->index == i)
+				{
+					code.update(item.Transformation2D());
+					code.update(pending->key);
+					pending++;
+				}
+				else
+				{
+					code.update(item);
+				}
 			}
 
 			return code.digest();
@@ -454,74 +1668,186 @@ namespace sc {
 			flash::Shape& shape = m_writer.swf.shapes.emplace_back();
 			shape.id = id;
 
-			m_writer.AddGraphicGroup(m_group);
+			// Group is not used by this writer anymore, its pending items are filled by writer when all symbols are done
+			std::vector<std::function<void()>> fills;
+			fills.reserve(m_pending_items.size());
+			for (PendingItem& pending : m_pending_items)
+			{
+				fills.push_back(std::move(pending.fill));
+			}
+
+			m_writer.AddGraphicGroup(std::move(m_group), std::move(fills));
+			m_pending_items.clear();
 
 			return true;
 		}
 
-		void SCShapeWriter::CreateCanvas(const Animate::DOM::Utils::RECT bound, float resolution)
+		wk::Unique<RasterizingContext> SCShapeWriter::CreateCanvas(const Animate::DOM::Utils::RECT bound, float resolution, size_t thread_count)
 		{
-			canvas = wk::CreateUnique<RasterizingContext>();
+			wk::Unique<RasterizingContext> canvas = wk::CreateUnique<RasterizingContext>();
+			// Small regions drawn with low resolution still take at least one pixel
 			canvas->image = wk::CreateRef<wk::RawImage>(
-				std::ceil(bound.topLeft.x - bound.bottomRight.x) * resolution,
-				std::ceil(bound.topLeft.y - bound.bottomRight.y) * resolution,
+				std::max(std::ceil(bound.topLeft.x - bound.bottomRight.x) * resolution, 1.f),
+				std::max(std::ceil(bound.topLeft.y - bound.bottomRight.y) * resolution, 1.f),
 				wk::Image::PixelDepth::RGBA8,
 				wk::Image::ColorSpace::Linear
 			);
 			SCShapeWriter::CreateImage(canvas->image, canvas->canvas_image, false);
 
-			canvas->ctx = BLContext(canvas->canvas_image);
+			canvas->ctx = SCShapeWriter::CreateContext(canvas->canvas_image, thread_count);
+
+			return canvas;
 		}
 
-		void SCShapeWriter::ReleaseCanvas()
+		BLContext SCShapeWriter::CreateContext(BLImage& image, size_t thread_count)
 		{
-			bl_assert(canvas->ctx.end());
-			canvas.reset();
+			// Synchronization of rendering threads costs more than it gives on small canvases
+			// Busy pool leaves no threads for canvas, so it is drawn by the calling thread alone
+			if (2 > thread_count || SCShapeWriter::MultithreadedCanvasPixels > (size_t)image.width() * image.height())
+			{
+				return BLContext(image);
+			}
+
+			BLContextCreateInfo info{};
+			info.threadCount = (uint32_t)thread_count;
+
+			return BLContext(image, info);
 		}
 
-		void SCShapeWriter::ReleaseVectorGraphic()
+		void SCShapeWriter::ReleaseCanvas(RasterizingContext& canvas)
 		{
-			//if (m_vector_graphics.empty()) return;
+			bl_assert(canvas.ctx.end());
 		}
 
-		void SCShapeWriter::DrawRegion(const Animate::Publisher::FilledElementRegion& region, wk::PointF offset, float resolution)
+		std::pmr::memory_resource* SCShapeWriter::InputMemory()
 		{
-			// Contour drawing
+			if (!m_writer.shape_arenas) return &m_writer.shape_heap;
+
+			// Created on first use, shapes without triangulated regions don't need it
+			if (!m_input_arena)
+			{
+				m_input_arena = wk::CreateRef<SynchronizedArena>(&m_writer.shape_heap);
+			}
+
+			return m_input_arena.get();
+		}
+
+		void SCShapeWriter::AddPendingItem(uint64_t key, std::function<void(GraphicItem&)>&& fill)
+		{
+			size_t index = m_group.Size() - 1;
+
+			// Group owns items by reference, so item address is kept when group is moved to writer
+			GraphicItem* item = (GraphicItem*)&m_group[index];
+
+			PendingItem& pending = m_pending_items.emplace_back();
+			pending.index = index;
+			pending.key = key;
+			pending.fill = [item, fill = std::move(fill)]() { fill(*item); };
+		}
+
+		void SCShapeWriter::ReleaseVectorGraphic()
+		{
+			if (m_vector_graphics.empty()) return;
+
+			struct Batch
+			{
+				RegionBound bound;
+
+				// Region indices in draw order
+				std::vector<size_t> regions;
+			};
+
+			// Regions are combined into batches with overlapping or touching bounds.
+			// Bounds of different batches never intersect, so their draw order does not matter.
+			std::vector<Batch> batches;
+
+			auto flush = [this, &batches]()
+			{
+				std::sort(batches.begin(), batches.end(), [](const Batch& first, const Batch& second) {
+					return first.regions.front() < second.regions.front();
+				});
+
+				for (const Batch& batch : batches)
+				{
+					std::vector<const FilledElementRegion*> regions;
+					for (size_t index : batch.regions)
+					{
+						regions.push_back(&m_vector_graphics[index]);
+					}
+
+					AddRasterizedRegions(regions, m_vector_matrix);
+				}
+
+				batches.clear();
+			};
+
+			for (size_t i = 0; m_vector_graphics.size() > i; i++)
 			{
-				BLPath contour;
-				SCShapeWriter::CreatePath(region.contour, offset, contour, resolution);
+				const FilledElementRegion& region = m_vector_graphics[i];
+
+				Batch current;
+				current.bound = RegionBound(region.Bound());
+				current.regions.push_back(i);
+
+				// Bound grows with every merge, so repeat until nothing else intersects
+				bool merged = true;
+				while (merged)
+				{
+					merged = false;
+					for (auto it = batches.begin(); it != batches.end();)
+					{
+						if (!it->bound.Intersects(current.bound, SCShapeWriter::RasterizationBatchGap))
+						{
+							it++;
+							continue;
+						}
+
+						current.bound = current.bound.Union(it->bound);
+						current.regions.insert(current.regions.end(), it->regions.begin(), it->regions.end());
+						it = batches.erase(it);
+						merged = true;
+					}
+				}
+
+				std::sort(current.regions.begin(), current.regions.end());
+				batches.push_back(std::move(current));
+			}
+
+			flush();
+			m_vector_graphics.clear();
+		}
+
+		void SCShapeWriter::DrawRegion(
+			RasterizingContext& canvas,
+			const RasterRegion& region,
+			wk::PointF offset,
+			float resolution
+		)
+		{
+			BLPath contour;
+			SCShapeWriter::CreatePath(region.contour, offset, contour, resolution);
 
+			// Fills path with region style on any context
+			auto fill_path = [&region, resolution](BLContext& ctx, const BLPath& path)
+			{
 				BLResult result = BL_SUCCESS;
 				if (region.type == FilledElementRegion::ShapeType::SolidColor)
 				{
-					const auto& fill = std::get<FilledElementRegion::SolidFill>(region.style);
+					const auto& color = region.color;
 
-					result = canvas->ctx.fillPath(
-						contour, 
-						BLRgba32(fill.color.blue, fill.color.green, fill.color.red, fill.color.alpha)
+					result = ctx.fillPath(
+						path,
+						BLRgba32(color.blue, color.green, color.red, color.alpha)
 					);
 				}
-				else if (region.type == FilledElementRegion::ShapeType::Bitmap)
+				else if (region.type == FilledElementRegion::ShapeType::Bitmap && region.bitmap)
 				{
-					const auto& fill = std::get<FilledElementRegion::BitmapFill>(region.style);
-
-					fill.bitmap.ExportImage(m_writer.sprite_temp_path);
-
-					wk::RawImageRef image;
+					wk::RawImageRef image = region.bitmap;
 					BLImage texture;
-					{
-						wk::InputFileStream file(m_writer.sprite_temp_path);
-						wk::stb::load_image(file, image);
-					}
-					SCShapeWriter::CreateImage(image, texture, true);
+					SCShapeWriter::CreateImage(image, texture, false);
 					BLPattern pattern(texture);
 
-					auto matrix = fill.bitmap.Transformation();
-					matrix.a /= Animate::DOM::TWIPS_PER_PIXEL;
-					matrix.b /= Animate::DOM::TWIPS_PER_PIXEL;
-					matrix.c /= Animate::DOM::TWIPS_PER_PIXEL;
-					matrix.d /= Animate::DOM::TWIPS_PER_PIXEL;
-
+					auto matrix = region.bitmap_matrix;
 					matrix.a *= resolution;
 					matrix.c *= resolution;
 
@@ -536,154 +1862,177 @@ namespace sc {
 					};
 					result = pattern.setTransform(pattern_matrix);
 					bl_assert(result);
-					
-					result = canvas->ctx.fillPath(contour, pattern);
+
+					result = ctx.fillPath(path, pattern);
 				}
 				bl_assert(result);
+			};
+
+			if (region.holes.empty())
+			{
+				fill_path(canvas.ctx, contour);
+				return;
+			}
+
+			BLBox box;
+			bl_assert(contour.getBoundingBox(&box));
+
+			std::vector<BLPath> holes(region.holes.size());
+			std::vector<BLBox> hole_boxes(region.holes.size());
+			for (size_t i = 0; region.holes.size() > i; i++)
+			{
+				SCShapeWriter::CreatePath(region.holes[i], offset, holes[i], resolution);
+				bl_assert(holes[i].getBoundingBox(&hole_boxes[i]));
 			}
 
-			// Hole drawing
+			// Even-odd fill cuts holes right out of contour only if every hole is covered by contour once.
+			// Holes of Animate regions lie inside contour and don't overlap each other, boxes are checked to be sure.
+			bool disjoint_holes = true;
+			for (size_t i = 0; hole_boxes.size() > i && disjoint_holes; i++)
 			{
-				canvas->ctx.setCompOp(BLCompOp::BL_COMP_OP_CLEAR);
-				for (const auto& hole : region.holes)
-				{
-					BLPath contour;
-					SCShapeWriter::CreatePath(hole, offset, contour, resolution);
+				const BLBox& hole = hole_boxes[i];
+				disjoint_holes =
+					hole.x0 >= box.x0 && hole.y0 >= box.y0 &&
+					box.x1 >= hole.x1 && box.y1 >= hole.y1;
 
-					BLResult result = canvas->ctx.fillPath(
-						contour, BLRgba32(0)
-					);
-					bl_assert(result);
+				for (size_t j = i + 1; hole_boxes.size() > j && disjoint_holes; j++)
+				{
+					const BLBox& other = hole_boxes[j];
+					disjoint_holes =
+						other.x0 >= hole.x1 || hole.x0 >= other.x1 ||
+						other.y0 >= hole.y1 || hole.y0 >= other.y1;
 				}
-
-				canvas->ctx.setCompOp(BLCompOp::BL_COMP_OP_SRC_OVER);
 			}
-		}
 
-		void SCShapeWriter::DrawRegionTo(
-			const wk::RawImageRef target,
-			const Animate::Publisher::FilledElementRegion& region,
-			wk::Point offset,
-			float resolution
-		)
-		{
-			wk::RawImageRef sprite;
-			wk::Point region_offset;
-			DrawRegion(region, resolution, sprite, region_offset);
+			int left = std::max((int)std::floor(box.x0), 0);
+			int top = std::max((int)std::floor(box.y0), 0);
+			int right = std::min((int)std::ceil(box.x1), canvas.canvas_image.width());
+			int bottom = std::min((int)std::ceil(box.y1), canvas.canvas_image.height());
+			if (left >= right || top >= bottom) return;
 
-			for (uint16_t h = 0; sprite->height() > h; h++)
+			BLPath path = contour;
+			for (const BLPath& hole : holes)
 			{
-				for (uint16_t w = 0; sprite->width() > w; w++)
-				{
-					auto& source = sprite->at<wk::ColorRGBA>(w, h);
-					if (!source.a) continue;
+				bl_assert(path.addPath(hole));
+			}
+
+			// Draws region in its own layer, aligned to canvas pixels so coverage of every pixel is the same as on canvas
+			// Layer pixels below holes are cleared without touching pixels of other regions on canvas
+			auto draw_layer = [&](bool even_odd)
+			{
+				BLImage layer(right - left, bottom - top, BL_FORMAT_PRGB32);
 
-					uint16_t dstW = w + (region_offset.x - offset.x);
-					uint16_t dstH = h + (region_offset.y - offset.y);
+				BLContext ctx(layer);
+				ctx.clearAll();
+				ctx.translate(-left, -top);
 
-					if (dstW >= target->width() || dstH >= target->height())
+				if (even_odd)
+				{
+					ctx.setFillRule(BL_FILL_RULE_EVEN_ODD);
+					fill_path(ctx, path);
+				}
+				else
+				{
+					fill_path(ctx, contour);
+
+					ctx.setCompOp(BLCompOp::BL_COMP_OP_CLEAR);
+					for (const BLPath& hole : holes)
 					{
-						continue;
+						bl_assert(ctx.fillPath(hole, BLRgba32(0)));
 					}
+				}
+
+				bl_assert(ctx.end());
+				return layer;
+			};
 
-					auto& dest = target->at<wk::ColorRGBA>(dstW, dstH);
+			if (!disjoint_holes)
+			{
+				bl_assert(canvas.ctx.blitImage(BLPointI(left, top), draw_layer(false)));
+				return;
+			}
+
+#ifndef NDEBUG
+			// Even-odd fill must give the same pixels as contour with cleared holes,
+			// only anti-aliasing of pixels crossed by both contour and hole edge may differ a bit
+			{
+				BLImage expected = draw_layer(false);
+				BLImage actual = draw_layer(true);
 
-					float alpha_fac = (255 - (float)source.a) / 255;
-					float alpha = (float)source.a + (float)dest.a * alpha_fac;
+				BLImageData expected_data;
+				BLImageData actual_data;
+				bl_assert(expected.getData(&expected_data));
+				bl_assert(actual.getData(&actual_data));
 
-					float red = (float)source.r + (float)dest.r * alpha_fac;
-					float green = (float)source.g + (float)dest.g * alpha_fac;
-					float blue = (float)source.b + (float)dest.b * alpha_fac;
+				for (int y = 0; expected_data.size.h > y; y++)
+				{
+					const uint8_t* expected_row = (const uint8_t*)expected_data.pixelData + y * expected_data.stride;
+					const uint8_t* actual_row = (const uint8_t*)actual_data.pixelData + y * actual_data.stride;
 
-					dest.r = std::ceil(red);
-					dest.g = std::ceil(green);
-					dest.b = std::ceil(blue);
-					dest.a = std::ceil(alpha);
+					for (int x = 0; expected_data.size.w * 4 > x; x++)
+					{
+						assert(SCShapeWriter::EvenOddTolerance >= std::abs((int)expected_row[x] - (int)actual_row[x]));
+					}
 				}
 			}
+#endif
+
+			// One pass for contour and all holes right on canvas
+			canvas.ctx.save();
+			canvas.ctx.setFillRule(BL_FILL_RULE_EVEN_ODD);
+			fill_path(canvas.ctx, path);
+			canvas.ctx.restore();
 		}
 
-		void SCShapeWriter::DrawRegion(const Animate::Publisher::FilledElementRegion& region, float resolution, wk::RawImageRef& result, wk::Point& result_offset)
+		void SCShapeWriter::DrawRegions(
+			const std::vector<RasterRegion>& regions,
+			float resolution,
+			wk::RawImageRef& result, wk::Point& result_offset,
+			size_t thread_count
+		)
 		{
-			Animate::DOM::Utils::RECT bound = region.Bound();
+			Animate::DOM::Utils::RECT bound = SCShapeWriter::GetRegionsBound(regions);
+
 			wk::PointF offset(-std::min(bound.topLeft.x, bound.bottomRight.x), -std::min(bound.topLeft.y, bound.bottomRight.y));
 			result_offset.x = bound.bottomRight.x;
 			result_offset.y = bound.bottomRight.y;
 
 			SCShapeWriter::RoundDomRectangle(bound);
-			CreateCanvas(bound, resolution);
+			wk::Unique<RasterizingContext> canvas = CreateCanvas(bound, resolution, thread_count);
 
-			DrawRegion(region, offset, resolution);
+			for (const RasterRegion& region : regions)
+			{
+				DrawRegion(*canvas, region, offset, resolution);
+			}
 
 			result = canvas->image;
-			ReleaseCanvas();
+			ReleaseCanvas(*canvas);
 		}
 
-		void SCShapeWriter::RoundRegion(Animate::Publisher::FilledElementRegion& path)
+		void SCShapeWriter::CreateImage(wk::RawImageRef& image, BLImage& texture, bool premultiply)
 		{
-			SCShapeWriter::RoundPath(path.contour);
-
-			for (auto& hole : path.holes)
+			if (premultiply)
 			{
-				SCShapeWriter::RoundPath(hole);
+				SCShapeWriter::PremultiplyImage(image);
 			}
-		}
-
-		void SCShapeWriter::RoundPath(Animate::Publisher::FilledElementPath& path)
-		{
-			for (size_t i = 0; path.Count() > i; i++)
+			else if (image->depth() != wk::Image::PixelDepth::RGBA8)
 			{
-				auto& segment = path.GetSegment(i);
-
-				switch (segment.SegmentType())
-				{
-				case FilledElementPathSegment::Type::Line:
-				{
-					auto& seg = (FilledElementPathLineSegment&)segment;
-					seg.begin.x = std::round(seg.begin.x);
-					seg.begin.y = std::round(seg.begin.y);
-					seg.end.x = std::round(seg.end.x);
-					seg.end.y = std::round(seg.end.y);
-				}
-				break;
-				case FilledElementPathSegment::Type::Cubic:
-				{
-					auto& seg = (FilledElementPathCubicSegment&)segment;
-					seg.begin.x = std::round(seg.begin.x);
-					seg.begin.y = std::round(seg.begin.y);
-
-					seg.control_l.x = std::round(seg.control_l.x);
-					seg.control_l.y = std::round(seg.control_l.y);
-					seg.control_r.x = std::round(seg.control_r.x);
-					seg.control_r.y = std::round(seg.control_r.y);
-					
-					seg.end.x = std::round(seg.end.x);
-					seg.end.y = std::round(seg.end.y);
-				}
-				break;
-
-				case FilledElementPathSegment::Type::Quad:
-				{
-					auto& seg = (FilledElementPathQuadSegment&)segment;
-					seg.begin.x = std::round(seg.begin.x);
-					seg.begin.y = std::round(seg.begin.y);
-
-					seg.control.x = std::round(seg.control.x);
-					seg.control.y = std::round(seg.control.y);
-
-					seg.end.x = std::round(seg.end.x);
-					seg.end.y = std::round(seg.end.y);
-				}
-				break;
+				wk::RawImageRef converted = wk::CreateRef<wk::RawImage>(
+					image->width(), image->height(), wk::Image::PixelDepth::RGBA8
+				);
 
-				default:
-					break;
-				}
+				image->copy(*converted);
+				image = converted;
 			}
-			
+
+			BLResult result = texture.createFromData(
+				image->width(), image->height(),
+				BLFormat::BL_FORMAT_PRGB32, image->data(), image->pixel_size() * image->width()
+			);
+			bl_assert(result);
 		}
 
-		void SCShapeWriter::CreateImage(wk::RawImageRef& image, BLImage& texture, bool premultiply)
+		void SCShapeWriter::PremultiplyImage(wk::RawImageRef& image)
 		{
 			if (image->depth() != wk::Image::PixelDepth::RGBA8)
 			{
@@ -695,28 +2044,19 @@ namespace sc {
 				image = converted;
 			}
 
-			if (premultiply)
+			for (uint16_t h = 0; image->height() > h; h++)
 			{
-				for (uint16_t h = 0; image->height() > h; h++)
+				for (uint16_t w = 0; image->width() > w; w++)
 				{
-					for (uint16_t w = 0; image->width() > w; w++)
-					{
-						wk::ColorRGBA& pixel = image->at<wk::ColorRGBA>(w, h);
+					wk::ColorRGBA& pixel = image->at<wk::ColorRGBA>(w, h);
 
-						float alpha = (float)pixel.a / 255.f;
+					float alpha = (float)pixel.a / 255.f;
 
-						pixel.r = (uint8_t)(pixel.r * alpha);
-						pixel.g = (uint8_t)(pixel.g * alpha);
-						pixel.b = (uint8_t)(pixel.b * alpha);
-					}
+					pixel.r = (uint8_t)(pixel.r * alpha);
+					pixel.g = (uint8_t)(pixel.g * alpha);
+					pixel.b = (uint8_t)(pixel.b * alpha);
 				}
 			}
-
-			BLResult result = texture.createFromData(
-				image->width(), image->height(),
-				BLFormat::BL_FORMAT_PRGB32, image->data(), image->pixel_size() * image->width()
-			);
-			bl_assert(result);
 		}
 	}
 }
@@ -733,8 +2073,7 @@ namespace wk::hash
 			if (item.IsSprite())
 			{
 				const sc::Adobe::BitmapItem& sprite = (const sc::Adobe::BitmapItem&)item;
-				const auto& image = sprite.Image();
-				stream.update((const wk::Image&)image);
+				stream.update(sprite.ImageHash());
 			
 				if (sprite.Is9Sliced())
 				{
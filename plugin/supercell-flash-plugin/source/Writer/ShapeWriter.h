@@ -6,6 +6,16 @@
 #include "core/image/raw_image.h"
 
 #include <blend2d.h>
+#include <CDT.h>
+
+#include "Writer/TriangulationCache.h"
+#include "Writer/SynchronizedArena.h"
+#include "Writer/GraphicItem/SpriteItem.h"
+#include "Writer/GraphicItem/SlicedItem.h"
+
+#include <functional>
+#include <future>
+#include <memory_resource>
 
 namespace sc {
 	namespace Adobe {
@@ -18,6 +28,27 @@ namespace sc {
 			BLContext ctx;
 		};
 
+		// Flattened geometry of solid region that is shared by every consumer of region
+		struct RegionGeometry
+		{
+			// Region has quadratic or cubic segments
+			bool curved = false;
+
+			// Polylines without closing points, curves are flattened with tessellation tolerance
+			std::vector<Animate::Publisher::Point2D> contour;
+			std::vector<std::vector<Animate::Publisher::Point2D>> holes;
+		};
+
+		// Straight solid region that waits to be merged with abutting regions of the same color
+		struct StraightRegion
+		{
+			RegionGeometry geometry;
+			Animate::DOM::Utils::COLOR color;
+
+			// Region is small enough to be added without triangulation
+			bool is_contour = false;
+		};
+
 		class SCShapeWriter : public Animate::Publisher::SharedShapeWriter {
 		public:
 			SCShapeWriter(SCWriter& writer, Animate::Publisher::SymbolContext& symbol) :
@@ -27,6 +58,33 @@ namespace sc {
 
 			static inline const float RasterizationResolution = 2.f;
 
+			// Max distance in screen pixels between curve and its tessellated chords
+			static inline const float TessellationTolerance = 0.25f;
+
+			// Curved regions that need more triangles are rasterized
+			static inline const size_t TessellationTriangleBudget = 1024;
+
+			// Stroke outlines are long and thin, so they get more triangles
+			static inline const size_t StrokeTessellationTriangleBudget = 4096;
+
+			// Vertex count of draw command is stored in one byte
+			static inline const size_t MaxPolygonVertices = 255;
+
+			// Rasterized regions closer than this distance are drawn into one canvas
+			static inline const float RasterizationBatchGap = 2.f;
+
+			// Hole-free contours with more vertices go to Delaunay triangulation, ear clipping is quadratic
+			static inline const size_t EarClippingMaxVertices = 128;
+
+			// Stack buffer of arena for triangle merging temporaries of one triangulation job
+			static inline const size_t MergingArenaSize = 16 * 1024;
+
+			// Max channel difference between even-odd fill of region with holes and contour with cleared holes, checked in debug builds
+			static inline const int EvenOddTolerance = 8;
+
+			// Canvases with more pixels are drawn by several blend2d threads
+			static inline const size_t MultithreadedCanvasPixels = 1024 * 1024;
+
 		public:
 			virtual void AddGraphic(const Animate::Publisher::BitmapElement& item);
 			virtual void AddFilledElement(const Animate::Publisher::FilledElement& shape);
@@ -39,12 +97,32 @@ namespace sc {
 
 		public:
 			void AddTriangulatedRegion(
-				const Animate::Publisher::FilledElementPath& contour,
-				const std::vector<Animate::Publisher::FilledElementPath>& holes,
+				const std::vector<Animate::Publisher::Point2D>& contour,
+				const std::vector<std::vector<Animate::Publisher::Point2D>>& holes,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				const Animate::DOM::Utils::COLOR& color
+			);
+
+			/// <summary>
+			/// Triangulates abutting regions of one color as one polygon, edges shared by regions are removed
+			/// </summary>
+			void AddCoalescedRegions(
+				const std::vector<const RegionGeometry*>& regions,
 				const Animate::DOM::Utils::MATRIX2D& matrix,
 				const Animate::DOM::Utils::COLOR& color
 			);
 
+			/// <summary>
+			/// Triangulates flattened geometry of curved solid fill region
+			/// </summary>
+			/// <returns>False if region needs more triangles than budget allows</returns>
+			bool AddTessellatedRegion(
+				const RegionGeometry& geometry,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				const Animate::DOM::Utils::COLOR& color,
+				size_t triangle_budget = TessellationTriangleBudget
+			);
+
 			//void AddRasterizedRegion(
 			//	const Animate::Publisher::FilledElementRegion& region,
 			//	wk::RawImage& canvas,
@@ -58,69 +136,262 @@ namespace sc {
 				float resolution = 1.f
 			);
 
+			/// <summary>
+			/// Rasterizes regions into one sprite in given order
+			/// </summary>
+			void AddRasterizedRegions(
+				const std::vector<const Animate::Publisher::FilledElementRegion*>& regions,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				float resolution = 1.f
+			);
+
+			/// <summary>
+			/// Queues drawing of rasterized sprite or takes it from cache
+			/// </summary>
+			/// <param name="source">Vector source of sprite</param>
+			/// <param name="resolution">Draw resolution</param>
+			/// <param name="transform">Result sprite transformation in shape</param>
+			static std::shared_future<HashedImage> RasterizeAsync(
+				SCWriter& writer,
+				const wk::Ref<RasterizedSource>& source,
+				float resolution,
+				Animate::DOM::Utils::MATRIX2D& transform
+			);
+
+			/// <summary>
+			/// Draws 9-slice elements into one sprite. Doesn't use DOM, so can be called from workers.
+			/// </summary>
+			/// <param name="source">Vector source of sprite</param>
+			/// <param name="resolution">Draw resolution</param>
+			/// <param name="sprite">Result sprite with its hash</param>
+			/// <param name="offset">Sprite offset in scaled space</param>
+			/// <param name="guides">Scaling grid in scaled space</param>
+			/// <param name="transform">Sprite transformation that scales it back</param>
+			/// <param name="thread_count">Threads that canvas may use, taken from JobPool::ThreadBudget</param>
+			static void RasterizeSlice(
+				const SlicedSource& source,
+				float resolution,
+				HashedImage& sprite,
+				wk::Point& offset,
+				Animate::DOM::Utils::RECT& guides,
+				Animate::DOM::Utils::MATRIX2D& transform,
+				size_t thread_count = 1
+			);
+
 		public:
-			void AddFilledShapeRegion(const Animate::Publisher::FilledElementRegion& region, const Animate::DOM::Utils::MATRIX2D& matrix);
-			bool IsValidFilledShapeRegion(const Animate::Publisher::FilledElementRegion& region);
-			bool IsComplexShapeRegion(const Animate::Publisher::FilledElementRegion& region);
+			/// <param name="is_stroke">Region is outline of stroke</param>
+			void AddFilledShapeRegion(const Animate::Publisher::FilledElementRegion& region, const Animate::DOM::Utils::MATRIX2D& matrix, bool is_stroke = false);
+			static bool IsValidFilledShapeRegion(const Animate::Publisher::FilledElementRegion& region);
+
+			/// <summary>
+			/// Walks solid region segments once and flattens them with tolerance picked from matrix scale
+			/// </summary>
+			static void AnalyseRegion(
+				const Animate::Publisher::FilledElementRegion& region,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				RegionGeometry& geometry
+			);
 
 		public:
 			static void RoundDomRectangle(Animate::DOM::Utils::RECT& rect);
 
+			/// <summary>
+			/// Converts image to RGBA8 and premultiplies its colors by alpha. RGBA8 image is changed in place.
+			/// </summary>
+			static void PremultiplyImage(wk::RawImageRef& image);
+
 		private: // canvas releated functions
+			// Canvas functions are static and work only with their arguments so they can be used by workers
 
 			/// <summary>
 			/// Create canvas context by given bound
 			/// </summary>
 			/// <param name="bound"></param>
-			void CreateCanvas(const Animate::DOM::Utils::RECT bound, float resolution);
+			static wk::Unique<RasterizingContext> CreateCanvas(const Animate::DOM::Utils::RECT bound, float resolution, size_t thread_count = 1);
+
+			/// <summary>
+			/// Create drawing context for image, multithreaded for big ones
+			/// </summary>
+			/// <param name="thread_count">Threads that context may use, share of pool threads that are not busy with jobs</param>
+			static BLContext CreateContext(BLImage& image, size_t thread_count);
 
 			/// <summary>
 			/// Destroy canvas context and flush drawing
 			/// </summary>
-			void ReleaseCanvas();
+			static void ReleaseCanvas(RasterizingContext& canvas);
 
 			/// <summary>
-			/// Draw region on existing image
+			/// Reads path, fill and texture of region from DOM, so result can be passed to workers.
+			/// Must be called only from publishing thread.
 			/// </summary>
-			/// <param name="image">Draw surface</param>
-			/// <param name="region">Region itself</param>
-			/// <param name="offset">Surface offset</param>
-			/// <param name="resolution">Draw resolution</param>
-			void DrawRegionTo(const wk::RawImageRef image, const Animate::Publisher::FilledElementRegion& region, wk::Point offset, float resolution = 1.f);
+			RasterRegion LoadRasterRegion(const Animate::Publisher::FilledElementRegion& region);
+
+			static void LoadRasterPath(const Animate::Publisher::FilledElementPath& path, RasterPath& result);
 
 			/// <summary>
-			/// Draw region in active canvas context
+			/// Draw region in canvas context
 			/// </summary>
+			/// <param name="canvas">Canvas context</param>
 			/// <param name="region">Region itself</param>
 			/// <param name="offset">Region offset</param>
 			/// <param name="resolution">Draw resolution</param>
-			void DrawRegion(const Animate::Publisher::FilledElementRegion& region, wk::PointF offset, float resolution = 1.f);
+			static void DrawRegion(RasterizingContext& canvas, const RasterRegion& region, wk::PointF offset, float resolution = 1.f);
 
 			/// <summary>
-			/// Draw region
+			/// Draw regions on one canvas that covers all of them
 			/// </summary>
-			/// <param name="region">Region itself</param>
+			/// <param name="regions">Regions in draw order</param>
 			/// <param name="resolution">Draw resolution</param>
 			/// <param name="result">Result image</param>
-			/// <param name="offset">Result region offset</param>
-			void DrawRegion(const Animate::Publisher::FilledElementRegion& region, float resolution, wk::RawImageRef& result, wk::Point& offset);
+			/// <param name="offset">Result offset</param>
+			/// <param name="thread_count">Threads that canvas may use</param>
+			static void DrawRegions(
+				const std::vector<RasterRegion>& regions,
+				float resolution,
+				wk::RawImageRef& result, wk::Point& offset,
+				size_t thread_count = 1
+			);
+
+			static void CreatePath(const RasterPath& path, wk::PointF offset, BLPath& contour, float resolution = 1.f);
+
+			/// <summary>
+			/// Hash of deduplicated triangulation input relative to its bound
+			/// </summary>
+			static uint64_t GetTriangulationKey(const std::pmr::vector<CDT::V2d<float>>& vertices, const std::pmr::vector<CDT::Edge>& edges);
+
+			/// <summary>
+			/// Converts path to polyline with adaptive count of points per curve
+			/// </summary>
+			/// <param name="path">Source path</param>
+			/// <param name="tolerance">Max distance between curve and chords in path space</param>
+			/// <param name="points">Result points without closing one</param>
+			/// <param name="curved">Set if path has any curve segment</param>
+			static void FlattenPath(const Animate::Publisher::FilledElementPath& path, float tolerance, std::vector<Animate::Publisher::Point2D>& points, bool& curved);
+
+			/// <summary>
+			/// Triangulates simple contour by ear clipping
+			/// </summary>
+			/// <param name="vertices">Contour points in order, without duplicates</param>
+			/// <param name="triangles">Result counter clockwise triangles</param>
+			/// <returns>False if contour crosses itself or has no area</returns>
+			static bool ClipEars(const std::pmr::vector<CDT::V2d<float>>& vertices, std::vector<TriangulationCache::Triangle>& triangles);
+
+			/// <summary>
+			/// Removes edges that are walked even number of times and vertices that are not used by other edges
+			/// </summary>
+			/// <param name="vertices">Deduplicated vertices</param>
+			/// <param name="edges">Edges of all merged regions</param>
+			static void RemoveSharedEdges(std::pmr::vector<CDT::V2d<float>>& vertices, std::pmr::vector<CDT::Edge>& edges);
 
-			static void CreatePath(const Animate::Publisher::FilledElementPath& path, wk::PointF offset, BLPath& contour, float resolution = 1.f);
+			/// <summary>
+			/// Greedily merges adjacent triangles into convex polygons (Hertel-Mehlhorn)
+			/// </summary>
+			/// <param name="vertices">Triangle vertices</param>
+			/// <param name="triangles">Triangle indices</param>
+			/// <param name="result">Counter clockwise convex polygons that can be drawn as fans. Temporaries use its memory resource.</param>
+			static void MergeTriangles(
+				const std::pmr::vector<CDT::V2d<float>>& vertices,
+				const std::vector<TriangulationCache::Triangle>& triangles,
+				std::pmr::vector<std::pmr::vector<uint32_t>>& result
+			);
 
-			static void RoundRegion(Animate::Publisher::FilledElementRegion& path);
-			static void RoundPath(Animate::Publisher::FilledElementPath& path);
+			/// <summary>
+			/// Hash of 9-slice regions, guides and bitmaps. Equal for the same slice in any symbol.
+			/// </summary>
+			static uint64_t GetSliceKey(const SlicedSource& source);
+
+			static Animate::DOM::Utils::RECT GetRegionsBound(const std::vector<RasterRegion>& regions);
+
+			/// <summary>
+			/// Hash of everything that affects rasterized pixels of regions except resolution.
+			/// Geometry is taken relative to bound and matrix is applied only to drawn sprite,
+			/// so placement of regions does not change the key.
+			/// </summary>
+			static uint64_t GetRasterizationKey(
+				const std::vector<RasterRegion>& regions,
+				const Animate::DOM::Utils::RECT& bound
+			);
 
 			static void CreateImage(wk::RawImageRef& image, BLImage& result, bool premultiply);
 
+		private: // jobs
+			// Group item which content is still produced by worker
+			struct PendingItem
+			{
+				// Index of item in group
+				size_t index = 0;
+
+				// Hash of job input, used for shape hash instead of item content
+				uint64_t key = 0;
+
+				// Waits for job and fills item with its result
+				std::function<void()> fill;
+			};
+
+			/// <summary>
+			/// Marks last item of group as pending. Item is already in group, so draw order is kept without waiting for job.
+			/// </summary>
+			/// <param name="key">Hash of job input</param>
+			/// <param name="fill">Fills item with job result, called by writer on finalize</param>
+			void AddPendingItem(uint64_t key, std::function<void(GraphicItem&)>&& fill);
+
+			/// <summary>
+			/// Memory for triangulation input of this shape, arena of shape or plain heap if arenas are turned off
+			/// </summary>
+			std::pmr::memory_resource* InputMemory();
+
+			// Triangulation input, picks the fastest triangulator that handles it
+			enum class PolygonKind : uint8_t
+			{
+				// One contour without holes, may still cross itself
+				Simple,
+				WithHoles,
+
+				// Several regions that share edges
+				Coalesced
+			};
+
+			/// <summary>
+			/// Adds item and queues triangulation of polygon edges that fills it
+			/// </summary>
+			void TriangulateAsync(
+				std::pmr::vector<CDT::V2d<float>>&& vertices,
+				std::pmr::vector<CDT::Edge>&& edges,
+				const Animate::DOM::Utils::MATRIX2D& matrix,
+				const Animate::DOM::Utils::COLOR& color,
+				PolygonKind kind
+			);
+
 		private:
+			/// <summary>
+			/// Rasterizes all pending vector regions.
+			/// Must be called before anything else is added to group to keep draw order.
+			/// </summary>
 			void ReleaseVectorGraphic();
 
+			/// <summary>
+			/// Merges abutting straight regions of the same color and adds them to group
+			/// </summary>
+			void ReleaseStraightRegions();
+
 		private:
 			SCWriter& m_writer;
 			Animate::Publisher::StaticElementsGroup m_group;
-			wk::Unique<RasterizingContext> canvas;
 
-			//std::vector<FilledElementRegion> m_vector_graphics;
+			// Items that are still produced by workers, in group order
+			std::vector<PendingItem> m_pending_items;
+
+			// Arena of triangulation inputs, shared with jobs so it lives until the last of them is done
+			wk::Ref<SynchronizedArena> m_input_arena;
+
+			// Regions that are waiting to be rasterized, all of them have the same matrix
+			std::vector<Animate::Publisher::FilledElementRegion> m_vector_graphics;
+			Animate::DOM::Utils::MATRIX2D m_vector_matrix;
+
+			// Straight solid fills of current element, all of them have the same matrix
+			std::vector<StraightRegion> m_straight_regions;
+			Animate::DOM::Utils::MATRIX2D m_straight_matrix;
+			bool m_coalesce_regions = false;
 		};
 	}
 }
\ No newline at end of file
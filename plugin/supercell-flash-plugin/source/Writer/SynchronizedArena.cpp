@@ -0,0 +1,20 @@
+#include "SynchronizedArena.h"
+
+namespace sc {
+	namespace Adobe {
+		void* SynchronizedArena::do_allocate(size_t bytes, size_t alignment)
+		{
+			std::lock_guard lock(m_mutex);
+			return m_arena.allocate(bytes, alignment);
+		}
+
+		void SynchronizedArena::do_deallocate(void* /*pointer*/, size_t /*bytes*/, size_t /*alignment*/)
+		{
+		}
+
+		bool SynchronizedArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+		{
+			return this == &other;
+		}
+	}
+}
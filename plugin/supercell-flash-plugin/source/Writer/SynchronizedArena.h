@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace sc {
+	namespace Adobe {
+		// Monotonic arena that can be used by several threads at once
+		// Deallocation does nothing, all memory is released together with arena
+		class SynchronizedArena : public std::pmr::memory_resource
+		{
+		public:
+			SynchronizedArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+				m_arena(upstream)
+			{
+			}
+
+		protected:
+			virtual void* do_allocate(size_t bytes, size_t alignment) override;
+			virtual void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+			virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		private:
+			std::mutex m_mutex;
+			std::pmr::monotonic_buffer_resource m_arena;
+		};
+	}
+}
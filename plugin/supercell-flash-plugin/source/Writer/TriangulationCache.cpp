@@ -0,0 +1,32 @@
+#include "TriangulationCache.h"
+
+namespace sc {
+	namespace Adobe {
+		bool TriangulationCache::Find(uint64_t key, size_t vertex_count, std::vector<Triangle>& triangles)
+		{
+			{
+				std::lock_guard lock(m_mutex);
+
+				auto it = m_entries.find(key);
+				if (it != m_entries.end() && it->second.vertex_count == vertex_count)
+				{
+					triangles = it->second.triangles;
+					m_hits++;
+					return true;
+				}
+			}
+
+			m_misses++;
+			return false;
+		}
+
+		void TriangulationCache::Insert(uint64_t key, size_t vertex_count, const std::vector<Triangle>& triangles)
+		{
+			std::lock_guard lock(m_mutex);
+
+			Entry& entry = m_entries[key];
+			entry.vertex_count = vertex_count;
+			entry.triangles = triangles;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sc {
+	namespace Adobe {
+		// Triangles of already triangulated contour sets, shared between all shapes
+		// Can be used from workers
+		class TriangulationCache
+		{
+		public:
+			// Indices of deduplicated input vertices
+			using Triangle = std::array<uint32_t, 3>;
+
+		public:
+			/// <summary>
+			/// Finds triangles by geometry key
+			/// </summary>
+			/// <param name="key">Geometry key</param>
+			/// <param name="vertex_count">Count of input vertices, protects indices from key collisions</param>
+			/// <param name="triangles">Result triangles</param>
+			/// <returns>True if cache has triangles for this geometry</returns>
+			bool Find(uint64_t key, size_t vertex_count, std::vector<Triangle>& triangles);
+
+			void Insert(uint64_t key, size_t vertex_count, const std::vector<Triangle>& triangles);
+
+			size_t Hits() const
+			{
+				return m_hits;
+			}
+
+			size_t Misses() const
+			{
+				return m_misses;
+			}
+
+		private:
+			struct Entry
+			{
+				size_t vertex_count = 0;
+				std::vector<Triangle> triangles;
+			};
+
+			std::mutex m_mutex;
+			std::unordered_map<uint64_t, Entry> m_entries;
+
+			std::atomic<size_t> m_hits = 0;
+			std::atomic<size_t> m_misses = 0;
+		};
+	}
+}
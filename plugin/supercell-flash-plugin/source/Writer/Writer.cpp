@@ -12,13 +12,38 @@
 
 #include "Reassemble/Object.hpp"
 #include "Reassemble/Atlas.h"
+#include "Reassemble/Append.h"
+#include "Reassemble/Shelf.h"
+#include "AtlasItemStorage.h"
+
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <future>
+#include <numeric>
 
 using namespace Animate::Publisher;
 
 namespace sc {
 	namespace Adobe {
+		// Matrix that applies child transformation first and then parent
+		static wk::Matrix2D MultiplyMatrix(const wk::Matrix2D& parent, const wk::Matrix2D& child)
+		{
+			return wk::Matrix2D(
+				parent.a * child.a + parent.c * child.b,
+				parent.b * child.a + parent.d * child.b,
+				parent.a * child.c + parent.c * child.d,
+				parent.b * child.c + parent.d * child.d,
+				parent.a * child.tx + parent.c * child.ty + parent.tx,
+				parent.b * child.tx + parent.d * child.ty + parent.ty
+			);
+		}
+
 		SCWriter::SCWriter()
 		{
+			const SCConfig& config = SCPlugin::Publisher::ActiveConfig();
+			shape_arenas = config.shapeArenas;
 		}
 
 		SCWriter::~SCWriter()
@@ -114,13 +139,12 @@ namespace sc {
 		void SCWriter::ProcessDrawCommand(
 			flash::ShapeDrawBitmapCommand& command,
 			wk::AtlasGenerator::Item::Transformation& transform,
-			GraphicItem& item
+			const wk::Matrix2D& matrix
 		)
 		{
 			using namespace wk;
 			using namespace wk::AtlasGenerator;
 
-			wk::Matrix2D matrix = item.Transformation2D();
 			flash::SWFTexture& texture = swf.textures[command.texture_index];
 			if (command.vertices.empty()) return;
 
@@ -147,15 +171,16 @@ namespace sc {
 		void SCWriter::ProcessVertices(
 			flash::Shape& shape,
 			const wk::AtlasGenerator::Container<wk::AtlasGenerator::Vertex>& vertices,
-			wk::AtlasGenerator::Item& atlas_item,
-			GraphicItem& item
+			uint16_t texture_index,
+			wk::AtlasGenerator::Item::Transformation& transform,
+			const wk::Matrix2D& matrix
 		)
 		{
 			using namespace wk;
 			using namespace AtlasGenerator;
 
 			flash::ShapeDrawBitmapCommand& shape_command = shape.commands.emplace_back();
-			shape_command.texture_index = atlas_item.texture_index + texture_offset;
+			shape_command.texture_index = texture_index;
 
 			for (const Vertex& vertex : vertices)
 			{
@@ -167,16 +192,21 @@ namespace sc {
 				shape_vertex.v = vertex.uv.v;
 			}
 
-			ProcessDrawCommand(shape_command, atlas_item.transform, item);
+			ProcessDrawCommand(shape_command, transform, matrix);
 		}
 
 		void SCWriter::ProcessSpriteItem(
 			flash::Shape & shape,
 			wk::AtlasGenerator::Item& atlas_item,
-			BitmapItem& sprite_item
+			BitmapItem& sprite_item,
+			const wk::Matrix2D& orientation
 		)
 		{
-			ProcessVertices(shape, atlas_item.vertices, atlas_item, sprite_item);
+			ProcessVertices(
+				shape, atlas_item.vertices,
+				atlas_item.texture_index + texture_offset, atlas_item.transform,
+				MultiplyMatrix(sprite_item.Transformation2D(), orientation)
+			);
 		}
 
 		void SCWriter::ProcessSlicedItem(
@@ -201,7 +231,11 @@ namespace sc {
 
 			for (const Container<Vertex>& region : regions)
 			{
-				ProcessVertices(shape, region, atlas_item, sliced_item);
+				ProcessVertices(
+					shape, region,
+					atlas_item.texture_index + texture_offset, atlas_item.transform,
+					sliced_item.Transformation2D()
+				);
 			}
 
 			for (auto& command : shape.commands)
@@ -216,30 +250,78 @@ namespace sc {
 
 		void SCWriter::ProcessFilledItem(
 			flash::Shape& shape,
-			wk::AtlasGenerator::Item& atlas_item,
+			uint16_t texture_index,
+			const wk::AtlasGenerator::Vertex& colorfill,
+			wk::AtlasGenerator::Item::Transformation& transform,
 			FilledItem& filled_item
 		)
 		{
-			if (!atlas_item.get_colorfill().has_value()) return;
-
-			auto atlas_point = atlas_item.get_colorfill().value();
-
 			for (const FilledItemContour& contour : filled_item.contours)
 			{
 				flash::ShapeDrawBitmapCommand& shape_command = shape.commands.emplace_back();
-				shape_command.texture_index = atlas_item.texture_index + texture_offset;
+				shape_command.texture_index = texture_index;
 
 				for (const Point2D& point : contour.Contour())
 				{
 					flash::ShapeDrawBitmapCommandVertex& shape_vertex = shape_command.vertices.emplace_back();
 
-					shape_vertex.u = atlas_point.uv.x;
-					shape_vertex.v = atlas_point.uv.y;
+					shape_vertex.u = colorfill.uv.x;
+					shape_vertex.v = colorfill.uv.y;
 					shape_vertex.x = point.x;
 					shape_vertex.y = point.y;
 				}
 
-				ProcessDrawCommand(shape_command, atlas_item.transform, filled_item);
+				ProcessDrawCommand(shape_command, transform, filled_item.Transformation2D());
+			}
+		}
+
+		void SCWriter::ProcessPlacement(
+			flash::Shape& shape,
+			const flash::AtlasAppender::Placement& placement,
+			const AtlasItemStorage::Entry& entry,
+			GraphicItem& item,
+			const wk::Matrix2D& orientation
+		)
+		{
+			using namespace wk;
+			using namespace wk::AtlasGenerator;
+
+			Item::Transformation transform(
+				0,
+				Point(placement.x, placement.y)
+			);
+
+			if (entry.image)
+			{
+				const float width = (float)entry.image->width();
+				const float height = (float)entry.image->height();
+
+				Container<Vertex> vertices;
+				vertices.reserve(4);
+
+				const PointF corners[] = { {0.f, 0.f}, {width, 0.f}, {width, height}, {0.f, height} };
+				for (const PointF& corner : corners)
+				{
+					Vertex& vertex = vertices.emplace_back();
+					vertex.xy.x = corner.x;
+					vertex.xy.y = corner.y;
+					vertex.uv.u = (uint16_t)corner.x;
+					vertex.uv.v = (uint16_t)corner.y;
+				}
+
+				ProcessVertices(
+					shape, vertices,
+					placement.texture_index, transform,
+					MultiplyMatrix(item.Transformation2D(), orientation)
+				);
+			}
+			else
+			{
+				Vertex colorfill;
+				colorfill.uv.u = 0;
+				colorfill.uv.v = 0;
+
+				ProcessFilledItem(shape, placement.texture_index, colorfill, transform, (FilledItem&)item);
 			}
 		}
 
@@ -254,38 +336,127 @@ namespace sc {
 				context.locale.GetString("TID_STATUS_SPRITE_PACK")
 			);
 
-			std::vector<AtlasGenerator::Item> items;
+			// Same sprites and colors are packed only once and shared between all graphic items
+			AtlasItemStorage storage(config.spriteMeshVertices);
+			std::vector<AtlasGenerator::Item>& items = storage.Items();
+
+			// Atlas item for each graphic item in all groups
+			std::vector<AtlasItemStorage::Reference> item_references;
+			item_references.reserve(
+				std::accumulate(m_graphic_groups.begin(), m_graphic_groups.end(), (size_t)0, [](size_t count, const GraphicGroup& group) {
+					return count + group.Size();
+				})
+			);
 
+			size_t reoriented_count = 0;
 			for (GraphicGroup& group : m_graphic_groups)
 			{
 				for (size_t i = 0; group.Size() > i; i++)
 				{
-					GraphicItem& item = (GraphicItem&)group[i];
+					const GraphicItem& item = (const GraphicItem&)group[i];
+					const AtlasItemStorage::Reference& reference = item_references.emplace_back(storage.Add(item));
 
-					if (item.IsSprite())
+					if (!reference.orientation.IsIdentity())
 					{
-						BitmapItem& sprite_item = (BitmapItem&)item;
+						reoriented_count++;
+					}
+				}
+			}
 
-						auto& atlas_item = items.emplace_back(
-							sprite_item.Image(),
-							item.Is9Sliced()
-						);
+			context.logger->info(
+				"Atlas items: {} unique of {} graphic items, {} of them are drawn flipped or rotated",
+				items.size(), item_references.size(), reoriented_count
+			);
+			context.logger->info("Atlas items: {} transparent pixels trimmed", storage.TrimmedPixels());
+			context.logger->info("Atlas items: {} sprites use tight mesh", storage.MeshedSprites());
+
+			// Free space of textures from external file
+			wk::Unique<flash::AtlasAppender> appender;
+			if (config.exportToExternal && config.appendAtlas && texture_offset != 0)
+			{
+				appender = wk::CreateUnique<flash::AtlasAppender>(swf, texture_offset);
+			}
+
+			// Items that were placed right into external or shelf textures and should not be packed by generator
+			std::vector<std::optional<flash::AtlasAppender::Placement>> placements(items.size());
 
-						if (sprite_item.IsRasterizedVector() || item.Is9Sliced())
+			if (appender)
+			{
+				for (size_t i = 0; items.size() > i; i++)
+				{
+					const AtlasItemStorage::Entry& entry = storage.GetEntry(i);
+
+					if (entry.image)
+					{
+						// 9Slice regions and scaled sprites can be produced only by generator
+						if (!entry.sliced && config.textureScaleFactor == 1)
 						{
-							// Rasterized sprites already has premultiplied alpha so no need to preprocess it
-							atlas_item.mark_as_preprocessed();
+							placements[i] = appender->insert(*entry.image, !entry.preprocessed);
 						}
 					}
-					else if (item.IsSolidColor())
+					else
 					{
-						FilledItem& filled_item = (FilledItem&)item;
+						placements[i] = appender->insert(entry.color);
+					}
+				}
+
+				appender->finalize();
 
-						items.emplace_back(filled_item.Color());
+				size_t appended_count = std::count_if(placements.begin(), placements.end(), [](const auto& placement) { return placement.has_value(); });
+				context.logger->info(
+					"Atlas append: {} of {} items placed into external textures, {} of {} textures modified",
+					appended_count, items.size(),
+					appender->touched_count(), texture_offset
+				);
+			}
+
+			// Draft packaging puts plain rectangles on shelves of new textures instead of polygon nesting
+			wk::Unique<flash::ShelfPacker> shelf_packer;
+			std::vector<size_t> shelf_indices;
+			if (config.packagingEffort == SCConfig::PackagingEffort::Draft)
+			{
+				shelf_packer = wk::CreateUnique<flash::ShelfPacker>(config.textureMaxWidth, config.textureMaxHeight);
+
+				std::vector<size_t> order;
+				for (size_t i = 0; items.size() > i; i++)
+				{
+					if (!placements[i].has_value())
+					{
+						order.push_back(i);
+					}
+				}
+
+				// Tall items first so shelves have less wasted height
+				std::stable_sort(order.begin(), order.end(), [&storage](size_t first, size_t second) {
+					const AtlasItemStorage::Entry& first_entry = storage.GetEntry(first);
+					const AtlasItemStorage::Entry& second_entry = storage.GetEntry(second);
+
+					uint16_t first_height = first_entry.image ? first_entry.image->height() : 0;
+					uint16_t second_height = second_entry.image ? second_entry.image->height() : 0;
+
+					return first_height > second_height;
+				});
+
+				for (size_t i : order)
+				{
+					const AtlasItemStorage::Entry& entry = storage.GetEntry(i);
+
+					if (entry.image)
+					{
+						// Same as for appending, these are left to generator
+						if (!entry.sliced && config.textureScaleFactor == 1)
+						{
+							placements[i] = shelf_packer->insert(*entry.image, !entry.preprocessed);
+						}
 					}
 					else
 					{
-						throw Exception("Not implemented");
+						placements[i] = shelf_packer->insert(entry.color);
+					}
+
+					if (placements[i].has_value())
+					{
+						shelf_indices.push_back(i);
 					}
 				}
 			}
@@ -297,20 +468,45 @@ namespace sc {
 				2
 			);
 
-			int itemCount = (int)items.size();
+			using AtlasInput = std::reference_wrapper<AtlasGenerator::Item>;
+			AtlasGenerator::Container<AtlasInput> input;
+			std::vector<size_t> input_indices;
+			input.reserve(items.size());
+			input_indices.reserve(items.size());
+
+			for (size_t i = 0; items.size() > i; i++)
+			{
+				if (placements[i].has_value()) continue;
+
+				input.emplace_back(items[i]);
+				input_indices.push_back(i);
+			}
+
+			int itemCount = (int)input.size();
 			status->SetRange(itemCount);
 
 			generator_config.progress = [&status](uint32_t value) {
 				status->SetProgress(value);
 			};
 
-			AtlasGenerator::Generator generator(generator_config);
+			wk::Unique<AtlasGenerator::Generator> generator;
 
 			uint16_t texture_count = 0;
 
 			try
 			{
-				texture_count = generator.generate(items);
+				if (!input.empty())
+				{
+					if (config.packagingEffort == SCConfig::PackagingEffort::Best)
+					{
+						texture_count = PackAtlasBest(input, input_indices, storage, generator_config, generator);
+					}
+					else
+					{
+						generator = wk::CreateUnique<AtlasGenerator::Generator>(generator_config);
+						texture_count = generator->generate<AtlasInput>(input);
+					}
+				}
 			}
 			catch (const AtlasGenerator::PackagingException& exception)
 			{
@@ -346,20 +542,21 @@ namespace sc {
 
 				if (exception.index() != SIZE_MAX)
 				{
-					size_t atlas_item_index = 0;
+					size_t failed_index = input_indices[exception.index()];
+					size_t graphic_item_index = 0;
 					size_t group_index = 0;
-					for (; m_graphic_groups.size() >= group_index; group_index++)
+					for (; m_graphic_groups.size() > group_index; group_index++)
 					{
 						GraphicGroup& group = m_graphic_groups[group_index];
 						for (size_t group_item_index = 0; group.Size() > group_item_index; group_item_index++)
 						{
-							if (atlas_item_index == exception.index())
+							if (item_references[graphic_item_index].index == failed_index)
 							{
 								symbol_name = m_graphic_groups[group_index][group_item_index].Symbol().name;
 								goto FINALIZE_THROW;
 							};
 
-							atlas_item_index++;
+							graphic_item_index++;
 						}
 					}
 				
@@ -381,13 +578,34 @@ namespace sc {
 			context.Window()->DestroyStatusBar(status);
 
 			for (uint16_t i = 0; texture_count > i; i++) {
-				wk::RawImage& atlas = generator.get_atlas(i);
+				wk::RawImage& atlas = generator->get_atlas(i);
 
 				flash::SWFTexture& texture = swf.textures.emplace_back();
 				texture.load_from_image(atlas);
 			}
 
-			uint16_t command_index = 0;
+			if (shelf_packer)
+			{
+				// Shelf pages go right after generated ones
+				uint16_t shelf_offset = (uint16_t)(texture_offset + texture_count);
+				for (size_t i : shelf_indices)
+				{
+					placements[i]->texture_index += shelf_offset;
+				}
+
+				context.logger->info(
+					"Atlas draft packaging: {} of {} items placed on {} textures",
+					shelf_indices.size(), items.size(), shelf_packer->page_count()
+				);
+
+				for (const wk::RawImageRef& page : shelf_packer->finalize())
+				{
+					flash::SWFTexture& texture = swf.textures.emplace_back();
+					texture.load_from_image(*page);
+				}
+			}
+
+			size_t command_index = 0;
 			uint16_t shape_index = (swf.shapes.size() - m_graphic_groups.size());
 			for (uint32_t group_index = 0; m_graphic_groups.size() > group_index; group_index++, shape_index++)
 			{
@@ -396,10 +614,23 @@ namespace sc {
 
 				for (uint32_t group_item_index = 0; group.Size() > group_item_index; group_item_index++)
 				{
-					AtlasGenerator::Item& atlas_item = items[command_index];
+					const AtlasItemStorage::Reference& reference = item_references[command_index];
+					AtlasGenerator::Item& atlas_item = items[reference.index];
 					GraphicItem& item = (GraphicItem&)group[group_item_index];
+					auto& placement = placements[reference.index];
+
+					// Canonical atlas item can be flipped or rotated relative to graphic item
+					wk::Matrix2D orientation = storage.GetSourceMatrix(reference);
 
-					if (item.IsSprite())
+					if (placement.has_value())
+					{
+						ProcessPlacement(
+							shape, placement.value(),
+							storage.GetEntry(reference.index), item,
+							orientation
+						);
+					}
+					else if (item.IsSprite())
 					{
 						if (item.Is9Sliced())
 						{
@@ -412,7 +643,7 @@ namespace sc {
 						{
 							BitmapItem& sprite_item = *(BitmapItem*)&item;
 							ProcessSpriteItem(
-								shape, atlas_item, sprite_item
+								shape, atlas_item, sprite_item, orientation
 							);
 						}
 					}
@@ -420,7 +651,11 @@ namespace sc {
 					{
 						FilledItem& filled_item = *(FilledItem*)&item;
 						ProcessFilledItem(
-							shape, atlas_item, filled_item
+							shape,
+							atlas_item.texture_index + texture_offset,
+							atlas_item.get_colorfill().value(),
+							atlas_item.transform,
+							filled_item
 						);
 					}
 
@@ -428,7 +663,7 @@ namespace sc {
 				}
 			}
 
-			if (config.exportToExternal && config.repackAtlas)
+			if (config.exportToExternal && config.repackAtlas && !appender)
 			{
 				flash::repack_atlas(swf);
 			}
@@ -436,8 +671,11 @@ namespace sc {
 			wk::parallel::enumerate(
 				swf.textures.begin(),
 				swf.textures.end(),
-				[&config](flash::SWFTexture& texture, size_t)
+				[&config, &appender, this](flash::SWFTexture& texture, size_t n)
 				{
+					// Untouched external textures must keep their encoded data as is
+					if (appender && texture_offset > n && !appender->is_touched(n)) return;
+
 					if (config.textureEncoding == flash::SWFTexture::TextureEncoding::Raw)
 					{
 						if (texture.image()->base_type() == Image::BasePixelType::RGBA)
@@ -478,6 +716,227 @@ namespace sc {
 			}
 		}
 
+		void SCWriter::GetDisplayScales(std::unordered_map<uint16_t, float>& scales)
+		{
+			std::function<void(uint16_t, float)> process_display_object = [this, &scales, &process_display_object](uint16_t id, float scale)
+				{
+					// Object is processed again only if it was found with bigger scale
+					auto it = scales.find(id);
+					if (it != scales.end() && it->second >= scale) return;
+					scales[id] = scale;
+
+					flash::DisplayObject& object = swf.GetDisplayObjectByID(id);
+					if (!object.is_movieclip()) return;
+
+					const flash::MovieClip& movieclip = (const flash::MovieClip&)object;
+					for (const flash::MovieClipFrameElement& element : movieclip.frame_elements)
+					{
+						float element_scale = 1.f;
+						if (element.matrix_index != 0xFFFF)
+						{
+							const flash::Matrix2D& matrix = swf.matrixBanks[movieclip.bank_index].matrices[element.matrix_index];
+							element_scale = std::max(std::hypot(matrix.a, matrix.b), std::hypot(matrix.c, matrix.d));
+						}
+
+						if (element_scale <= 0.f) continue;
+
+						process_display_object(movieclip.childrens[element.instance_index].id, scale * element_scale);
+					}
+				};
+
+			// How exported symbols are displayed is unknown, so they are considered to be shown as is
+			for (flash::ExportName& export_name : swf.exports)
+			{
+				process_display_object(export_name.id, 1.f);
+			}
+		}
+
+		float SCWriter::GetRasterizationResolution(float scale)
+		{
+			return std::ceil(std::max(scale, MinRasterizationResolution) / RasterizationResolutionStep) * RasterizationResolutionStep;
+		}
+
+		float SCWriter::GetMatrixScale(const Animate::DOM::Utils::MATRIX2D& matrix)
+		{
+			return std::max(std::hypot(matrix.a, matrix.b), std::hypot(matrix.c, matrix.d));
+		}
+
+		void SCWriter::AdaptRasterizationResolution()
+		{
+			const SCConfig& config = SCPlugin::Publisher::ActiveConfig();
+			SCPlugin& context = SCPlugin::Instance();
+
+			// Without adaptive mode every shape is considered to be shown as is,
+			// but sprites that share artwork still get one drawing with the biggest placement scale
+			bool adaptive = true;
+			float max_resolution = 1.f;
+			switch (config.adaptiveRasterization)
+			{
+			case SCConfig::AdaptiveRasterization::Low:
+				max_resolution = 1.f;
+				break;
+			case SCConfig::AdaptiveRasterization::Medium:
+				max_resolution = 2.f;
+				break;
+			case SCConfig::AdaptiveRasterization::High:
+				max_resolution = 4.f;
+				break;
+			default:
+				adaptive = false;
+				break;
+			}
+
+			std::unordered_map<uint16_t, float> scales;
+			if (adaptive)
+			{
+				GetDisplayScales(scales);
+			}
+
+			// Sprites that are drawn again and their new content
+			struct Resample
+			{
+				// Items that get the same sprite
+				std::vector<BitmapItem*> items;
+
+				float resolution;
+				Animate::DOM::Utils::MATRIX2D transform;
+				std::shared_future<HashedImage> sprite;
+
+				// 9-slice only
+				wk::Point offset;
+				Animate::DOM::Utils::RECT guides;
+			};
+
+			// Deque keeps references valid for jobs that fill them
+			std::deque<Resample> resamples;
+
+			// Items with the same artwork are drawn once with the biggest resolution any of them needs,
+			// so all their placements keep sharing one sprite and one atlas item
+			struct Artwork
+			{
+				float resolution = 0.f;
+				std::vector<BitmapItem*> items;
+			};
+
+			// Content key / artwork. Sprites and 9-slices are kept apart because they are drawn differently.
+			std::unordered_map<uint64_t, Artwork> sprite_artworks;
+			std::unordered_map<uint64_t, Artwork> slice_artworks;
+
+			size_t shape_index = swf.shapes.size() - m_graphic_groups.size();
+			for (size_t group_index = 0; m_graphic_groups.size() > group_index; group_index++, shape_index++)
+			{
+				float display_scale = 1.f;
+				if (adaptive)
+				{
+					auto scale_it = scales.find(swf.shapes[shape_index].id);
+
+					// Shapes that are not used by exported symbols keep their resolution
+					if (scale_it == scales.end()) continue;
+
+					display_scale = std::clamp(scale_it->second, MinRasterizationResolution, max_resolution);
+				}
+
+				GraphicGroup& group = m_graphic_groups[group_index];
+				for (size_t i = 0; group.Size() > i; i++)
+				{
+					GraphicItem& item = (GraphicItem&)group[i];
+					if (!item.IsSprite()) continue;
+
+					BitmapItem& sprite_item = (BitmapItem&)item;
+					if (sprite_item.Is9Sliced())
+					{
+						SlicedItem& sliced_item = (SlicedItem&)item;
+						const wk::Ref<SlicedSource>& source = sliced_item.SliceSource();
+						if (!source) continue;
+
+						// 9-slice corners are not stretched, so they keep at least their own size
+						Artwork& artwork = slice_artworks[source->key];
+						artwork.resolution = std::max(artwork.resolution, std::max(SCWriter::GetRasterizationResolution(display_scale), 1.f));
+						artwork.items.push_back(&sprite_item);
+					}
+					else
+					{
+						const wk::Ref<RasterizedSource>& source = sprite_item.Source();
+						if (!source) continue;
+
+						// Key does not include matrix, so scale of each placement is taken into account here
+						float placement_scale = std::min(SCWriter::GetMatrixScale(source->matrix), MaxPlacementResolution);
+
+						Artwork& artwork = sprite_artworks[source->key];
+						artwork.resolution = std::max(artwork.resolution, SCWriter::GetRasterizationResolution(display_scale * placement_scale));
+						artwork.items.push_back(&sprite_item);
+					}
+				}
+			}
+
+			size_t replaced_items = 0;
+
+			// Resolution is stored per item, so every item is compared with canonical resolution on its own
+			// even if it shares vector source with already replaced one
+			for (auto& [key, artwork] : slice_artworks)
+			{
+				std::vector<BitmapItem*> items;
+				for (BitmapItem* item : artwork.items)
+				{
+					if (item->Resolution() != artwork.resolution) items.push_back(item);
+				}
+
+				if (items.empty()) continue;
+
+				// Slice sprite does not depend on placement, so one drawing is shared by all items
+				Resample& resample = resamples.emplace_back();
+				resample.items = std::move(items);
+				resample.resolution = artwork.resolution;
+
+				wk::Ref<SlicedSource> source = ((SlicedItem*)resample.items.front())->SliceSource();
+				float slice_resolution = artwork.resolution;
+				resample.sprite = jobs.Submit([this, source, slice_resolution, &resample]() {
+					HashedImage result;
+					SCShapeWriter::RasterizeSlice(*source, slice_resolution, result, resample.offset, resample.guides, resample.transform, jobs.ThreadBudget());
+
+					return result;
+				}).share();
+			}
+
+			for (auto& [key, artwork] : sprite_artworks)
+			{
+				for (BitmapItem* item : artwork.items)
+				{
+					if (item->Resolution() == artwork.resolution) continue;
+
+					// Transform depends on item matrix, drawing itself is shared through rasterization cache
+					Resample& resample = resamples.emplace_back();
+					resample.items = { item };
+					resample.resolution = artwork.resolution;
+					resample.sprite = SCShapeWriter::RasterizeAsync(*this, item->Source(), artwork.resolution, resample.transform);
+				}
+			}
+
+			for (Resample& resample : resamples)
+			{
+				HashedImage sprite = resample.sprite.get();
+
+				for (BitmapItem* item : resample.items)
+				{
+					if (item->Is9Sliced())
+					{
+						((SlicedItem*)item)->Replace(sprite, resample.transform, resample.offset, resample.guides, resample.resolution);
+					}
+					else
+					{
+						item->Replace(sprite, resample.transform, resample.resolution);
+					}
+				}
+
+				replaced_items += resample.items.size();
+			}
+
+			context.logger->info(
+				"Rasterization resolution: {} sprites replaced with {} drawings, {} display objects are used by exports, {} sprite and {} 9-slice artworks, adaptive {}, max display resolution {}",
+				replaced_items, resamples.size(), scales.size(), sprite_artworks.size(), slice_artworks.size(), adaptive, max_resolution
+			);
+		}
+
 		void SCWriter::Finalize() {
 			const SCConfig& config = SCPlugin::Publisher::ActiveConfig();
 			SCPlugin& context = SCPlugin::Instance();
@@ -497,11 +956,50 @@ namespace sc {
 				END
 			);
 
+			// Triangulation counters below are complete only when all jobs are done
+			JoinPendingItems();
+
 			if (config.exportToExternal)
 			{
 				flash::remove_unused(swf);
 			}
 
+			AdaptRasterizationResolution();
+
+			if (unsupported_fill_regions)
+			{
+				context.logger->warn(
+					"{} regions with gradient or other unsupported fill were dropped, publisher does not export their fill style",
+					unsupported_fill_regions
+				);
+			}
+
+			context.logger->info(
+				"Rasterization cache: {} hits, {} misses, {} key collisions",
+				rasterization_cache_hits, rasterization_cache_misses, rasterization_cache_collisions
+			);
+			context.logger->info(
+				"Triangulation cache: {} hits, {} misses",
+				triangulation_cache.Hits(), triangulation_cache.Misses()
+			);
+			context.logger->info(
+				"Shape memory with arenas {}: {} heap allocations ({} bytes) for triangulation inputs, merging temporaries and contours",
+				shape_arenas ? "on" : "off",
+				shape_heap_counters.allocations.load(), shape_heap_counters.bytes.load()
+			);
+			context.logger->info(
+				"Triangulation paths: {} convex fans, {} ear clipped, {} constrained Delaunay",
+				convex_fan_regions, ear_clipped_regions.load(), delaunay_regions.load()
+			);
+			context.logger->info(
+				"Region coalescing: {} regions merged into {} polygons",
+				coalesced_regions, coalesced_polygons
+			);
+			context.logger->info(
+				"Triangle merging: {} commands with {} vertices merged into {} commands with {} vertices",
+				triangle_commands.load(), triangle_vertices.load(), polygon_commands.load(), polygon_vertices.load()
+			);
+
 			status->SetProgress(ATLAS_FINALIZE);
 			status->SetStatusLabel(context.locale.GetString("TID_STATUS_TEXTURE_SAVE"));
 			FinalizeAtlas();
@@ -547,7 +1045,199 @@ namespace sc {
 			context.Window()->DestroyStatusBar(status);
 		}
 
-		wk::RawImageRef SCWriter::GetBitmap(const BitmapElement& item)
+		uint16_t SCWriter::PackAtlasBest(
+			wk::AtlasGenerator::Container<std::reference_wrapper<wk::AtlasGenerator::Item>>& input,
+			const std::vector<size_t>& input_indices,
+			const AtlasItemStorage& storage,
+			const wk::AtlasGenerator::Config& config,
+			wk::Unique<wk::AtlasGenerator::Generator>& result
+		)
+		{
+			using namespace wk;
+			using AtlasInput = std::reference_wrapper<AtlasGenerator::Item>;
+			using Clock = std::chrono::steady_clock;
+
+			SCPlugin& context = SCPlugin::Instance();
+
+			struct Candidate
+			{
+				Candidate(const AtlasGenerator::Config& base) : config(base)
+				{
+				}
+
+				AtlasGenerator::Config config;
+				Unique<AtlasGenerator::Generator> generator;
+
+				// Copy of items in candidate order
+				std::vector<AtlasGenerator::Item> items;
+				AtlasGenerator::Container<AtlasInput> input;
+
+				// Candidate position / input position
+				std::vector<size_t> order;
+
+				uint16_t texture_count = 0;
+
+				// Attempt finished without errors before deadline
+				bool finished = false;
+			};
+
+			const Clock::time_point deadline = Clock::now() + BestPackagingBudget;
+
+			// Width / height of each input item
+			std::vector<std::pair<uint32_t, uint32_t>> sizes(input.size(), { 1, 1 });
+			for (size_t i = 0; input.size() > i; i++)
+			{
+				const AtlasItemStorage::Entry& entry = storage.GetEntry(input_indices[i]);
+				if (entry.image)
+				{
+					sizes[i] = { entry.image->width(), entry.image->height() };
+				}
+			}
+
+			std::vector<std::function<bool(size_t, size_t)>> heuristics = {
+				// Largest area first
+				[&sizes](size_t first, size_t second) {
+					return sizes[first].first * sizes[first].second > sizes[second].first * sizes[second].second;
+				},
+				// Longest side first
+				[&sizes](size_t first, size_t second) {
+					return std::max(sizes[first].first, sizes[first].second) > std::max(sizes[second].first, sizes[second].second);
+				},
+				// Tallest first
+				[&sizes](size_t first, size_t second) {
+					return sizes[first].second > sizes[second].second;
+				}
+			};
+
+			std::vector<Unique<Candidate>> candidates;
+
+			for (auto& heuristic : heuristics)
+			{
+				Unique<Candidate>& candidate = candidates.emplace_back(CreateUnique<Candidate>(config));
+
+				candidate->order.resize(input.size());
+				std::iota(candidate->order.begin(), candidate->order.end(), 0);
+				std::stable_sort(candidate->order.begin(), candidate->order.end(), heuristic);
+
+				// Items must be copied before the original order starts to modify them
+				candidate->items.reserve(input.size());
+				for (size_t position : candidate->order)
+				{
+					candidate->items.push_back(input[position].get());
+				}
+
+				candidate->input.reserve(input.size());
+				for (AtlasGenerator::Item& item : candidate->items)
+				{
+					candidate->input.emplace_back(item);
+				}
+
+				// Progress of alternative attempts is not shown, status belongs to original order
+				candidate->config.progress = [](uint32_t) {};
+				candidate->generator = CreateUnique<AtlasGenerator::Generator>(candidate->config);
+			}
+
+			// Original order runs alone and first, so its errors are thrown right away and nothing is left running
+			result = CreateUnique<AtlasGenerator::Generator>(config);
+
+			Clock::time_point original_start = Clock::now();
+			uint16_t texture_count = result->generate<AtlasInput>(input);
+			Clock::duration attempt_duration = Clock::now() - original_start;
+
+			// Generators parallelize internally, so only a few attempts run at once
+			const size_t parallel_attempts = std::clamp<size_t>(JobPool::Concurrency() / BestPackagingThreadsPerAttempt, 1, candidates.size());
+
+			// Generator can't be stopped in the middle, so attempts are started only if they are expected
+			// to finish before deadline with margin and their results are discarded if they still finished too late.
+			// Attempts of one wave share threads that original order had alone, so wave is expected
+			// to take as long as its attempts one by one.
+			size_t next_candidate = 0;
+			while (candidates.size() > next_candidate)
+			{
+				size_t wave_size = std::min(parallel_attempts, candidates.size() - next_candidate);
+				while (wave_size && Clock::now() + attempt_duration * (Clock::rep)wave_size + BestPackagingMargin > deadline)
+				{
+					wave_size--;
+				}
+
+				if (!wave_size) break;
+
+				Clock::time_point wave_start = Clock::now();
+				std::vector<std::future<void>> tasks;
+				for (size_t i = 0; wave_size > i; i++)
+				{
+					Candidate* target = candidates[next_candidate++].get();
+					tasks.push_back(std::async(std::launch::async, [target, deadline]() {
+						try
+						{
+							target->texture_count = target->generator->generate<AtlasInput>(target->input);
+							target->finished = deadline >= Clock::now();
+						}
+						catch (...)
+						{
+							// Errors are reported by original order attempt
+						}
+					}));
+				}
+
+				// Candidates are owned by this function, so late attempts are awaited too
+				for (std::future<void>& task : tasks)
+				{
+					task.wait();
+				}
+
+				// Measured wave corrects estimate when attempts slow each other down more than expected
+				attempt_duration = std::max(attempt_duration, (Clock::now() - wave_start) / (Clock::rep)wave_size);
+			}
+
+			auto atlas_area = [](AtlasGenerator::Generator& generator, uint16_t count) {
+				uint64_t area = 0;
+				for (uint16_t i = 0; count > i; i++)
+				{
+					RawImage& atlas = generator.get_atlas(i);
+					area += (uint64_t)atlas.width() * atlas.height();
+				}
+
+				return area;
+			};
+
+			const uint64_t balanced_area = atlas_area(*result, texture_count);
+			uint64_t best_area = balanced_area;
+			Candidate* best = nullptr;
+			size_t finished_count = 0;
+
+			for (Unique<Candidate>& candidate : candidates)
+			{
+				if (!candidate->finished) continue;
+				finished_count++;
+
+				uint16_t best_count = best ? best->texture_count : texture_count;
+				uint64_t area = atlas_area(*candidate->generator, candidate->texture_count);
+				if (best_area > area || (best_area == area && best_count > candidate->texture_count))
+				{
+					best_area = area;
+					best = candidate.get();
+				}
+			}
+
+			context.logger->info(
+				"Atlas packaging: {} of {} alternative attempts finished in time, texture area {} (original order {})",
+				finished_count, candidates.size(), best_area, balanced_area
+			);
+
+			if (!best) return texture_count;
+
+			// Results are written back to original items
+			for (size_t position = 0; best->order.size() > position; position++)
+			{
+				input[best->order[position]].get() = best->items[position];
+			}
+
+			result = std::move(best->generator);
+			return best->texture_count;
+		}
+
+		HashedImage SCWriter::GetBitmap(const BitmapElement& item)
 		{
 			const std::u16string& name = item.Name();
 
@@ -561,14 +1251,59 @@ namespace sc {
 			wk::RawImageRef image;
 			wk::InputFileStream file(sprite_temp_path);
 			wk::stb::load_image(file, image);
-			m_cached_images[name] = image;
 
-			return image;
+			// Bitmap is hashed only once for all shapes that use it
+			HashedImage result(image);
+			m_cached_images[name] = result;
+
+			return result;
 		}
 
-		void SCWriter::AddGraphicGroup(const GraphicGroup& group)
+		HashedImage SCWriter::GetFillTexture(const BitmapElement& item)
 		{
-			m_graphic_groups.push_back(group);
+			const std::u16string& name = item.Name();
+
+			auto cached = m_cached_fill_textures.find(name);
+			if (cached != m_cached_fill_textures.end())
+			{
+				return cached->second;
+			}
+
+			// Bitmap image is shared with bitmap items, so texture is premultiplied copy of it
+			HashedImage bitmap = GetBitmap(item);
+			wk::RawImageRef texture = wk::CreateRef<wk::RawImage>(
+				bitmap.image->width(), bitmap.image->height(), wk::Image::PixelDepth::RGBA8
+			);
+			bitmap.image->copy(*texture);
+			SCShapeWriter::PremultiplyImage(texture);
+
+			// Premultiplied pixels depend only on bitmap, so its hash is reused
+			HashedImage result;
+			result.image = texture;
+			result.hash = bitmap.hash;
+			m_cached_fill_textures[name] = result;
+
+			return result;
+		}
+
+		void SCWriter::AddGraphicGroup(GraphicGroup&& group, std::vector<std::function<void()>>&& pending_items)
+		{
+			m_graphic_groups.push_back(std::move(group));
+
+			for (std::function<void()>& fill : pending_items)
+			{
+				m_pending_items.push_back(std::move(fill));
+			}
+		}
+
+		void SCWriter::JoinPendingItems()
+		{
+			for (std::function<void()>& fill : m_pending_items)
+			{
+				fill();
+			}
+
+			m_pending_items.clear();
 		}
 	}
 }
\ No newline at end of file
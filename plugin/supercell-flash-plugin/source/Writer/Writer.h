@@ -6,11 +6,20 @@
 #include "core/memory/ref.h"
 
 #include <filesystem>
+#include <chrono>
+#include <atomic>
 
 #include "Writer/GraphicItem/GraphicItem.h"
 #include "Writer/GraphicItem/FilledItem.h"
 #include "Writer/GraphicItem/SlicedItem.h"
 #include "Writer/GraphicItem/SpriteItem.h"
+#include "Writer/Reassemble/Append.h"
+#include "Writer/Reassemble/Shelf.h"
+#include "Writer/AtlasItemStorage.h"
+#include "Writer/JobPool.h"
+#include "Writer/TriangulationCache.h"
+#include "Writer/CountingResource.h"
+#include "Writer/SynchronizedArena.h"
 
 namespace sc {
 	namespace Adobe {
@@ -31,6 +40,34 @@ namespace sc {
 
 			virtual void Finalize();
 
+		public:
+			// Wall clock limit for alternative packaging attempts in Best effort mode.
+			// Limit is soft: running attempts can't be stopped, so packaging may take longer when they are slower than estimated.
+			static inline const std::chrono::seconds BestPackagingBudget = std::chrono::seconds(120);
+
+			// Part of budget left free when attempts are started, covers error of their duration estimate
+			static inline const std::chrono::seconds BestPackagingMargin = std::chrono::seconds(15);
+
+			// Each packaging attempt parallelizes internally, so only one attempt runs per this many threads
+			static inline const size_t BestPackagingThreadsPerAttempt = 4;
+
+			// Bounds and step of adaptive rasterization resolution
+			// Step keeps resolutions of similar shapes the same so their sprites still can be shared
+			static inline const float MinRasterizationResolution = 0.25f;
+			static inline const float RasterizationResolutionStep = 0.25f;
+
+			// Limit of placement scale that rasterized sprites are drawn with, so huge scale does not make huge sprites
+			static inline const float MaxPlacementResolution = 8.f;
+
+			/// <summary>
+			/// Resolution that sprite drawn in space of its regions needs to keep pixel density of given scale.
+			/// Rounded up to step so quality is never lower than needed.
+			/// </summary>
+			static float GetRasterizationResolution(float scale);
+
+			// Largest scale of matrix axes
+			static float GetMatrixScale(const Animate::DOM::Utils::MATRIX2D& matrix);
+
 		public:
 			// Path to temp sprite file
 			const fs::path sprite_temp_path = fs::path(tmpnam(nullptr)).concat(".png");
@@ -39,40 +76,145 @@ namespace sc {
 			flash::SupercellSWF swf;
 			size_t texture_offset = 0;
 
+			// Shared by triangulation jobs, so must outlive job pool
+			TriangulationCache triangulation_cache;
+
+			// Draw commands and vertices of triangulated regions before and after merging into convex polygons
+			std::atomic<size_t> triangle_commands = 0;
+			std::atomic<size_t> triangle_vertices = 0;
+			std::atomic<size_t> polygon_commands = 0;
+			std::atomic<size_t> polygon_vertices = 0;
+
+			// Regions by triangulation path: drawn as one fan, ear clipped or constrained Delaunay
+			size_t convex_fan_regions = 0;
+			std::atomic<size_t> ear_clipped_regions = 0;
+			std::atomic<size_t> delaunay_regions = 0;
+
+			// Abutting straight regions of the same color and polygons they were merged into
+			size_t coalesced_regions = 0;
+			size_t coalesced_polygons = 0;
+
+			// Regions dropped because their fill style is not exported by publisher, e.g. gradients.
+			// Only reported, such regions are not drawn in any way.
+			size_t unsupported_fill_regions = 0;
+
+			// Heap of triangulation inputs, merging temporaries and filled item contours.
+			// Arenas take their blocks from it too, so counters show real heap use with arenas turned on or off.
+			CountingResource::Counters shape_heap_counters;
+			CountingResource shape_heap{ shape_heap_counters };
+
+			// Shape memory goes through arenas, turned off only to measure heap use without them
+			bool shape_arenas = true;
+
+			// Contours of filled items are kept until atlas is packed, so they share one arena of publishing
+			SynchronizedArena contour_arena{ &shape_heap };
+
+			std::pmr::memory_resource* ContourMemory()
+			{
+				return shape_arenas ? (std::pmr::memory_resource*)&contour_arena : &shape_heap;
+			}
+
+			// Workers for rasterization and triangulation of shapes
+			JobPool jobs;
+
+			// Sprite with properties of its regions, checked on every cache hit so key collision does not give wrong sprite
+			struct RasterizedSprite
+			{
+				size_t region_count = 0;
+
+				// Canvas size in space of regions
+				float width = 0.f;
+				float height = 0.f;
+
+				float resolution = 0.f;
+				std::shared_future<HashedImage> sprite;
+			};
+
+			// Rasterization key / sprite
+			// Key does not include position, so regions that differ only in translation share one sprite
+			std::unordered_map<uint64_t, RasterizedSprite> rasterization_cache;
+			size_t rasterization_cache_hits = 0;
+			size_t rasterization_cache_misses = 0;
+			size_t rasterization_cache_collisions = 0;
+
 		public:
-			wk::RawImageRef GetBitmap(const Animate::Publisher::BitmapElement& item);
+			HashedImage GetBitmap(const Animate::Publisher::BitmapElement& item);
+
+			/// <summary>
+			/// Premultiplied texture of bitmap fill, loaded and hashed once per library bitmap.
+			/// Hash is the same as hash of bitmap itself.
+			/// </summary>
+			HashedImage GetFillTexture(const Animate::Publisher::BitmapElement& item);
 
-			void AddGraphicGroup(const GraphicGroup& group);
+			/// <summary>
+			/// Takes group of finalized shape
+			/// </summary>
+			/// <param name="pending_items">Fill group items that are still produced by workers</param>
+			void AddGraphicGroup(GraphicGroup&& group, std::vector<std::function<void()>>&& pending_items = {});
+
+			/// <summary>
+			/// Waits for workers and fills pending items of all shapes. Must be done before anything reads group items.
+			/// </summary>
+			void JoinPendingItems();
 
 		public:
 			uint16_t LoadExternal(fs::path path);
 
 			void FinalizeAtlas();
 
+			/// <summary>
+			/// Collects max scale of every display object relative to exported symbols
+			/// </summary>
+			void GetDisplayScales(std::unordered_map<uint16_t, float>& scales);
+
+			/// <summary>
+			/// Draws rasterized sprites again with resolution picked from max scale of their shapes
+			/// </summary>
+			void AdaptRasterizationResolution();
+
+			/// <summary>
+			/// Packs atlas with several item orders in parallel and keeps result with the smallest texture area.
+			/// Original order runs first and is always finished so errors are the same as in Balanced mode.
+			/// Other attempts are started only while they are expected to finish in time, results that come too late are discarded.
+			/// Budget is soft: attempts that were started are always awaited, even when they run past the deadline.
+			/// </summary>
+			/// <returns>Texture count of the best result</returns>
+			uint16_t PackAtlasBest(
+				wk::AtlasGenerator::Container<std::reference_wrapper<wk::AtlasGenerator::Item>>& input,
+				const std::vector<size_t>& input_indices,
+				const AtlasItemStorage& storage,
+				const wk::AtlasGenerator::Config& config,
+				wk::Unique<wk::AtlasGenerator::Generator>& result
+			);
+
 			// Some functions for atlas finalize
 
 			void ProcessDrawCommand(
 				flash::ShapeDrawBitmapCommand& command,
 				wk::AtlasGenerator::Item::Transformation& transform,
-				GraphicItem& item
+				const wk::Matrix2D& matrix
 			);
 
 			void ProcessVertices(
 				flash::Shape& shape,
 				const wk::AtlasGenerator::Container<wk::AtlasGenerator::Vertex>& vertices,
-				wk::AtlasGenerator::Item& atlas_item,
-				GraphicItem& item
+				uint16_t texture_index,
+				wk::AtlasGenerator::Item::Transformation& transform,
+				const wk::Matrix2D& matrix
 			);
 
 			void ProcessSpriteItem(
 				flash::Shape& shape,
 				wk::AtlasGenerator::Item& atlas_item,
-				BitmapItem& sprite_item
+				BitmapItem& sprite_item,
+				const wk::Matrix2D& orientation
 			);
 
 			void ProcessFilledItem(
 				flash::Shape& shape,
-				wk::AtlasGenerator::Item& atlas_item,
+				uint16_t texture_index,
+				const wk::AtlasGenerator::Vertex& colorfill,
+				wk::AtlasGenerator::Item::Transformation& transform,
 				FilledItem& filled_item
 			);
 
@@ -82,13 +224,27 @@ namespace sc {
 				SlicedItem& sprite_item
 			);
 
+			void ProcessPlacement(
+				flash::Shape& shape,
+				const flash::AtlasAppender::Placement& placement,
+				const AtlasItemStorage::Entry& entry,
+				GraphicItem& item,
+				const wk::Matrix2D& orientation
+			);
+
 		private:
 			// Storage for Atlas Generator guys.
 			// Represents swf shapes and must have the same size as shapes vector
 			std::vector<GraphicGroup> m_graphic_groups;
 
+			// Fill items of shapes whose jobs are not awaited yet, so several symbols are processed by workers at once
+			std::vector<std::function<void()>> m_pending_items;
+
 			// Name / Image
-			std::unordered_map<std::u16string, wk::RawImageRef> m_cached_images;
+			std::unordered_map<std::u16string, HashedImage> m_cached_images;
+
+			// Name / Premultiplied texture of bitmap fill
+			std::unordered_map<std::u16string, HashedImage> m_cached_fill_textures;
 		};
 	}
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ import { GetPublishContext } from "../../../Context";
 
 export default function SettingsMenu() {
     const [isExportToExternal, setExportToExternal] = useState(Settings.getParam("exportToExternal"));
+    const [isAppendAtlas, setAppendAtlas] = useState(Settings.getParam("appendAtlas"));
     const { toggleBackwardCompatibility, fileType } = GetPublishContext();
 
     let is_sc1 = fileType == SWFType.SC1;
@@ -78,6 +79,23 @@ export default function SettingsMenu() {
         }
     ).render()
 
+    const appendAtlas = new BoolField(
+        {
+            name: Locale.Get("TID_SWF_APPEND_ATLAS"),
+            keyName: "append_atlas_select",
+            defaultValue: Settings.getParam("appendAtlas"),
+            style: {
+                marginLeft: "2%",
+                marginBottom: "10px",
+                display: "flex",
+                alignItems: "center"
+            },
+            callback: [isAppendAtlas, setAppendAtlas],
+            tip_tid: "TID_SWF_APPEND_ATLAS_TIP"
+        }
+    ).render()
+    Settings.data["appendAtlas"] = isAppendAtlas;
+
     return SubMenu(
         Locale.Get("TID_ADDITIONAL_SETTINGS_LABEL"),
         "additional_settings",
@@ -86,7 +104,8 @@ export default function SettingsMenu() {
         },
         exportToExternal,
         isExportToExternal ? externalFilePath : undefined,
-        isExportToExternal ? repackAtlas : undefined,
+        isExportToExternal ? appendAtlas : undefined,
+        isExportToExternal && !isAppendAtlas ? repackAtlas : undefined,
         is_sc1 ? backwardCompatibility : undefined,
         TextureSettings(),
         OtherSettings()
@@ -50,6 +50,36 @@ export default function OtherSettings() {
         }
     );
 
+    const tessellateCurves = new BoolField(
+        {
+            name: Locale.Get("TID_SWF_SETTINGS_TESSELLATE_CURVES"),
+            keyName: "tessellate_curves",
+            defaultValue: Settings.getParam("tessellateCurves"),
+            style: {
+                display: "flex",
+                alignItems: "center",
+                marginBottom: "10px"
+            },
+            callback: value => (Settings.setParam("tessellateCurves", value)),
+            tip_tid: "TID_SWF_SETTINGS_TESSELLATE_CURVES_TIP"
+        }
+    );
+
+    const tessellateStrokes = new BoolField(
+        {
+            name: Locale.Get("TID_SWF_SETTINGS_TESSELLATE_STROKES"),
+            keyName: "tessellate_strokes",
+            defaultValue: Settings.getParam("tessellateStrokes"),
+            style: {
+                display: "flex",
+                alignItems: "center",
+                marginBottom: "10px"
+            },
+            callback: value => (Settings.setParam("tessellateStrokes", value)),
+            tip_tid: "TID_SWF_SETTINGS_TESSELLATE_STROKES_TIP"
+        }
+    );
+
     if (useBackwardCompatibility)
     {
         Settings.setParam("hasPrecisionMatrices", false);
@@ -77,6 +107,8 @@ export default function OtherSettings() {
         {
             marginBottom: "20%"
         },
-        ...sc1_dependent_options
+        ...sc1_dependent_options,
+        tessellateCurves.render(),
+        tessellateStrokes.render()
     )
 }
\ No newline at end of file
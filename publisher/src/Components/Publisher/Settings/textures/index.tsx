@@ -1,5 +1,5 @@
 import Locale from "../../../../Localization";
-import { Settings, SWFType, TextureDimensions, TextureEncoding, TextureScaleFactor } from "../../../../PublisherSettings";
+import { Settings, SpriteMeshVertices, SWFType, TextureDimensions, TextureEncoding, TextureScaleFactor } from "../../../../PublisherSettings";
 
 import BoolField from "../../../Shared/BoolField";
 import SubMenu from "../../../Shared/SubMenu";
@@ -16,6 +16,19 @@ const LocalizedTextureQuality = [
     Locale.Get("TID_LOW"),
 ]
 
+const LocalizedAdaptiveRasterization = [
+    Locale.Get("TID_DISABLED"),
+    Locale.Get("TID_LOW"),
+    Locale.Get("TID_MEDIUM"),
+    Locale.Get("TID_HIGH"),
+]
+
+const LocalizedPackagingEffort = [
+    Locale.Get("TID_PACKAGING_DRAFT"),
+    Locale.Get("TID_PACKAGING_BALANCED"),
+    Locale.Get("TID_PACKAGING_BEST"),
+]
+
 export default function TextureSettings() {
     const [textureEncodingMethod, setTextureEncodingMethod] = useState<TextureEncoding>(Settings.getParam("textureEncoding"));
     const [useMultiresStatus, setUseMultiresStatus] = useState<boolean>(Settings.getParam("hasMultiresTexture"));
@@ -204,6 +217,48 @@ export default function TextureSettings() {
         callback: value => (Settings.setParam("textureMaxHeight", TextureDimensions[value as never])),
     }).render();
 
+    const packagingEffort = new EnumField({
+        name: Locale.Get("TID_SWF_SETTINGS_PACKAGING_EFFORT"),
+        keyName: "packaging_effort_select",
+        enumeration: LocalizedPackagingEffort,
+        defaultValue: Settings.getParam("packagingEffort"),
+        style: {
+            display: "flex",
+            alignItems: "center",
+            marginBottom: "10px"
+        },
+        callback: value => (Settings.setParam("packagingEffort", parseInt(value))),
+        tip_tid: "TID_SWF_SETTINGS_PACKAGING_EFFORT_TIP"
+    }).render();
+
+    const spriteMeshVertices = new EnumField({
+        name: Locale.Get("TID_SWF_SETTINGS_SPRITE_MESH"),
+        keyName: "sprite_mesh_select",
+        enumeration: SpriteMeshVertices.map(value => value == 0 ? Locale.Get("TID_SPRITE_MESH_QUAD") : value.toString()),
+        defaultValue: SpriteMeshVertices.indexOf(Settings.getParam("spriteMeshVertices")) as never,
+        style: {
+            display: "flex",
+            alignItems: "center",
+            marginBottom: "10px"
+        },
+        callback: value => (Settings.setParam("spriteMeshVertices", SpriteMeshVertices[value as never])),
+        tip_tid: "TID_SWF_SETTINGS_SPRITE_MESH_TIP"
+    }).render();
+
+    const adaptiveRasterization = new EnumField({
+        name: Locale.Get("TID_SWF_SETTINGS_ADAPTIVE_RASTERIZATION"),
+        keyName: "adaptive_rasterization_select",
+        enumeration: LocalizedAdaptiveRasterization,
+        defaultValue: Settings.getParam("adaptiveRasterization"),
+        style: {
+            display: "flex",
+            alignItems: "center",
+            marginBottom: "10px"
+        },
+        callback: value => (Settings.setParam("adaptiveRasterization", parseInt(value))),
+        tip_tid: "TID_SWF_SETTINGS_ADAPTIVE_RASTERIZATION_TIP"
+    }).render();
+
     let texture_props: ReactNode[] = []
 
     if (useBackwardCompatibility) {
@@ -246,6 +301,9 @@ export default function TextureSettings() {
         useLowresTextures,
         scaleFactor,
         textureWidth,
-        textureHeight
+        textureHeight,
+        packagingEffort,
+        spriteMeshVertices,
+        adaptiveRasterization
     )
 }
\ No newline at end of file
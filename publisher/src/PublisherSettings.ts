@@ -19,6 +19,16 @@ export enum TextureScaleFactor {
     "x0.25"
 }
 
+// 0 keeps bounding quads
+export const SpriteMeshVertices = [
+    0,
+    4,
+    6,
+    8,
+    12,
+    16
+]
+
 export const TextureDimensions = [
     512,
     1024,
@@ -38,6 +48,19 @@ export enum Quality {
     low
 }
 
+export enum AdaptiveRasterization {
+    disabled,
+    low,
+    medium,
+    high
+}
+
+export enum PackagingEffort {
+    draft,
+    balanced,
+    best
+}
+
 export enum SWFType {
     SC1,
     SC2
@@ -54,11 +77,14 @@ type PublisherSettingsData = {
     compressionMethod: CompressionMethods,
     hasPrecisionMatrices: boolean,
     writeCustomProperties: boolean,
+    tessellateCurves: boolean,
+    tessellateStrokes: boolean,
 
     // Export to another file settings
     exportToExternal: boolean,
     exportToExternalPath: string,
     repackAtlas: boolean,
+    appendAtlas: boolean,
 
     // Texture category
     hasExternalTexture: boolean,
@@ -73,6 +99,9 @@ type PublisherSettingsData = {
     textureScaleFactor: TextureScaleFactor
     textureMaxWidth: number,
     textureMaxHeight: number,
+    packagingEffort: PackagingEffort,
+    spriteMeshVertices: number,
+    adaptiveRasterization: AdaptiveRasterization,
 }
 
 const PublisherDefaultSettings : PublisherSettingsData = 
@@ -85,10 +114,13 @@ const PublisherDefaultSettings : PublisherSettingsData =
     compressionMethod: CompressionMethods.ZSTD,
     hasPrecisionMatrices: false,
     writeCustomProperties: true,
+    tessellateCurves: false,
+    tessellateStrokes: false,
 
     exportToExternal: false,
     exportToExternalPath: "",
     repackAtlas: true,
+    appendAtlas: false,
 
     // Textures
     hasExternalTexture: true,
@@ -103,6 +135,9 @@ const PublisherDefaultSettings : PublisherSettingsData =
     textureScaleFactor: TextureScaleFactor["x1.0"],
     textureMaxWidth: 4096,
     textureMaxHeight: 4096,
+    packagingEffort: PackagingEffort.balanced,
+    spriteMeshVertices: 0,
+    adaptiveRasterization: AdaptiveRasterization.disabled,
 }
 
 export class PublisherSettings {